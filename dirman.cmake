@@ -7,8 +7,15 @@ set(DIRMANAGER_SRCS)
 
 list(APPEND DIRMANAGER_SRCS
     ${CMAKE_CURRENT_LIST_DIR}/src/dirman.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/src/dirman_backend.cpp
+    ${CMAKE_CURRENT_LIST_DIR}/src/dirman_async.cpp
     ${CMAKE_CURRENT_LIST_DIR}/include/DirManager/dirman.h
+    ${CMAKE_CURRENT_LIST_DIR}/include/DirManager/dirman_backend.h
+    ${CMAKE_CURRENT_LIST_DIR}/include/DirManager/dirman_async.h
     ${CMAKE_CURRENT_LIST_DIR}/src/dirman_private.h
+    ${CMAKE_CURRENT_LIST_DIR}/src/dirman_workqueue.h
+    ${CMAKE_CURRENT_LIST_DIR}/src/dirman_hash.h
+    ${CMAKE_CURRENT_LIST_DIR}/src/dirman_pathbuilder.h
 )
 
 if(WIN32)
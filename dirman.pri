@@ -7,8 +7,15 @@ win32:{
 }
 
 SOURCES += \
-    $$PWD/src/dirman.cpp
+    $$PWD/src/dirman.cpp \
+    $$PWD/src/dirman_backend.cpp \
+    $$PWD/src/dirman_async.cpp
 
 HEADERS += \
     $$PWD/include/DirManager/dirman.h \
-    $$PWD/src/dirman_private.h
+    $$PWD/include/DirManager/dirman_backend.h \
+    $$PWD/include/DirManager/dirman_async.h \
+    $$PWD/src/dirman_private.h \
+    $$PWD/src/dirman_workqueue.h \
+    $$PWD/src/dirman_hash.h \
+    $$PWD/src/dirman_pathbuilder.h
@@ -29,11 +29,70 @@
 #include <stack>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <type_traits>
+#include <stdint.h>
+
+class DirManBackend;
+class DirManAsync;
 
 class DirMan
 {
+    friend class DirManAsync;
     class DirMan_private;
     std::unique_ptr<DirMan_private> d;
+
+    static constexpr char foldAscii(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    //! Last (up to 8) case-folded characters of the suffix, the last character is the lowest byte
+    static constexpr uint64_t packSuffix(const char *s, size_t len, size_t k = 0)
+    {
+        return (k >= len || k >= 8) ? 0 :
+               ((static_cast<uint64_t>(static_cast<unsigned char>(foldAscii(s[len - 1 - k]))) << (8 * k)) |
+                packSuffix(s, len, k + 1));
+    }
+
+    static constexpr uint64_t suffixMask(size_t len)
+    {
+        return len >= 8 ? ~static_cast<uint64_t>(0) : ((static_cast<uint64_t>(1) << (8 * len)) - 1);
+    }
+
+    //! Last (up to 8) characters of the name packed like packSuffix(), ASCII letters are case-folded
+    static inline uint64_t foldedTail(const char *name, size_t length)
+    {
+        const size_t n = length < 8 ? length : 8;
+        uint64_t tail = 0;
+        for(size_t k = length - n; k < length; ++k)
+            tail = (tail << 8) | static_cast<unsigned char>(name[k]);
+
+        // Add 0x20 to every byte within 'A'...'Z' at once
+        const uint64_t ones = 0x0101010101010101ULL;
+        const uint64_t low = tail & (ones * 0x7F);
+        const uint64_t geA = low + ones * (0x80 - 'A');
+        const uint64_t gtZ = low + ones * (0x80 - 'Z' - 1);
+        const uint64_t upper = geA & ~gtZ & ~tail & (ones * 0x80);
+        return tail | (upper >> 2);
+    }
+
+    //! Compare characters of long suffixes which don't fit into the packed value
+    static bool matchSuffixHead(const char *name, size_t length, const char *suffix, size_t suffixLength);
+
+    template<size_t N>
+    static bool filterBySuffixes(const void *context, const char *name, size_t length)
+    {
+        return matchSuffixFilters(name, length, *static_cast<const Suffixes<N>*>(context));
+    }
+
+    bool getListOfFiles(std::vector<std::string> &list, bool (*filter)(const void *, const char *, size_t), const void *context);
+    bool getListOfFolders(std::vector<std::string> &list, bool (*filter)(const void *, const char *, size_t), const void *context);
+    size_t countEntries(bool (*filter)(const void *, const char *, size_t), const void *context,
+                        bool folders, bool recursive, size_t limit);
+    bool getListPage(uint64_t &position, bool &done, std::vector<std::string> &list, size_t pageSize,
+                     bool (*filter)(const void *, const char *, size_t), const void *context, bool folders);
+
 public:
 
     explicit DirMan(const std::string &dirPath = "./");
@@ -48,12 +107,259 @@ public:
      */
     static bool matchSuffixFilters(const std::string &name, const std::vector<std::string> &suffixFilters);
 
+    /**
+     * @brief Check if a filename matches a set of suffix filters (case-insensitive)
+     * @param name provided filename, doesn't have to be null-terminated
+     * @param length length of the filename
+     * @param suffixFilters list of possible filters
+     */
+    static bool matchSuffixFilters(const char *name, size_t length, const std::vector<std::string> &suffixFilters);
+
+    /**
+     * @brief Suffix filters known at compile time, made by suffixes()
+     *
+     * The last 8 characters of every suffix are case-folded and packed into an integer,
+     * so a name gets compared with a suffix by a single integer comparison.
+     */
+    template<size_t N>
+    struct Suffixes
+    {
+        uint64_t        packed[N];
+        uint64_t        mask[N];
+        uint32_t        length[N];
+        const char     *text[N];
+    };
+
+    /**
+     * @brief Make a set of suffix filters at compile time
+     * @param text suffixes, for example `DirMan::suffixes(".lvlx", ".lvl")`
+     * @return set of filters for matchSuffixFilters(), getListOfFiles() and getListOfFolders()
+     */
+    template<size_t... L>
+    static constexpr Suffixes<sizeof...(L)> suffixes(const char (&...text)[L])
+    {
+        return Suffixes<sizeof...(L)>{{packSuffix(text, L - 1)...},
+                                      {suffixMask(L - 1)...},
+                                      {static_cast<uint32_t>(L - 1)...},
+                                      {text...}};
+    }
+
+private:
+    //! No suffixes left
+    template<size_t N>
+    static bool matchSuffixFrom(const char *, size_t, uint64_t, const Suffixes<N> &, std::integral_constant<size_t, N>)
+    {
+        return false;
+    }
+
+    //! Compare with the I-th suffix, then with the following ones: one comparison per suffix, without a loop
+    template<size_t N, size_t I>
+    static bool matchSuffixFrom(const char *name, size_t length, uint64_t tail, const Suffixes<N> &suffixes,
+                                std::integral_constant<size_t, I>)
+    {
+        return ((tail & suffixes.mask[I]) == suffixes.packed[I] && length >= suffixes.length[I] &&
+                (suffixes.length[I] <= 8 || matchSuffixHead(name, length, suffixes.text[I], suffixes.length[I]))) ||
+               matchSuffixFrom(name, length, tail, suffixes, std::integral_constant<size_t, I + 1>());
+    }
+
+public:
+    /**
+     * @brief Check if a filename matches a set of compile-time suffix filters (case-insensitive)
+     *
+     * The comparisons are unrolled at compile time, one per suffix.
+     * @param name provided filename, doesn't have to be null-terminated
+     * @param length length of the filename
+     * @param suffixes filters made by suffixes()
+     */
+    template<size_t N>
+    static bool matchSuffixFilters(const char *name, size_t length, const Suffixes<N> &suffixes)
+    {
+        return matchSuffixFrom(name, length, foldedTail(name, length), suffixes, std::integral_constant<size_t, 0>());
+    }
+
+    template<size_t N>
+    static bool matchSuffixFilters(const std::string &name, const Suffixes<N> &suffixes)
+    {
+        return matchSuffixFilters(name.data(), name.size(), suffixes);
+    }
+
+    /**
+     * @brief Check if a filename matches a glob pattern (case-sensitive)
+     * @param name provided filename
+     * @param pattern glob pattern, supports `*`, `?` and `[...]` character classes (`[!...]` to negate)
+     */
+    static bool matchGlob(const std::string &name, const std::string &pattern);
+
+    /**
+     * @brief Directory walker settings
+     */
+    struct WalkerOptions
+    {
+        enum Order
+        {
+            //! Enter the most recently discovered directory first (default)
+            DEPTH_FIRST = 0,
+            //! Read all directories of one level before going deeper
+            BREADTH_FIRST
+        };
+
+        //! Order of directories traversal
+        Order order = DEPTH_FIRST;
+        //! Maximum depth of directories to enter (0 - the root directory only), -1 for unlimited
+        int maxDepth = -1;
+        //! Stop walking after this count of files has been returned, 0 for unlimited
+        size_t maxEntries = 0;
+        //! Stop walking after this count of directories has been read, 0 for unlimited
+        size_t maxDirectories = 0;
+        /*!
+         * Enter symbolic links to directories (default). Every directory reached through links
+         * is entered once, so symbolic link loops are safe; a link into the walked tree returns
+         * its directory under both paths. Otherwise linked directories are skipped.
+         */
+        bool followSymlinks = true;
+        //! Don't enter directories which belong to other file systems than the root directory (mount points)
+        bool oneFileSystem = false;
+        /*!
+         * Types of file systems which must not be entered when met at a mount point
+         * (for example "proc", "nfs", "cifs" or "fuse"), see fileSystemType()
+         */
+        std::vector<std::string> skipFileSystems;
+
+        //! Names of directories which must not be entered (for example ".git" or "node_modules")
+        std::vector<std::string> pruneNames;
+        //! Glob patterns of directory names which must not be entered (for example "*.bak")
+        std::vector<std::string> pruneGlobs;
+        //! Custom rule: receives the parent path and the directory name, returns true to skip the directory
+        std::function<bool(const std::string &parentPath, const std::string &name)> pruneCallback;
+        /*!
+         * Name of per-directory rule files (for example ".dirmanignore"), empty to disable.
+         * Each non-empty line which doesn't start with `#` is a glob pattern applied to the names
+         * of the files and directories inside that directory and all its subdirectories.
+         * A trailing `/` makes the rule match directories only, a leading `/` makes the rule
+         * match direct children only, a leading `!` re-includes previously excluded entries.
+         */
+        std::string ignoreFileName;
+        /*!
+         * Count of directories to read ahead by a background thread while the files
+         * of previous ones are processed, 0 to read every directory on request.
+         * Ignored when threads are disabled.
+         */
+        size_t prefetchDirectories = 0;
+        /*!
+         * Count of shards to split the walk into, 0 or 1 to walk the whole tree. Directories
+         * at the shardDepth level are assigned to shards by shardOf() of their path relative
+         * to the root, and only the owning shard enters them. Directories above that level are
+         * read by every shard, but their files are returned by the shard owning that directory only.
+         * Every process of a split scan uses the same tree, options and filters with its own shardIndex.
+         */
+        size_t shardCount = 0;
+        //! Shard of the walk to take, from 0 to shardCount - 1
+        size_t shardIndex = 0;
+        //! Depth of directories distributed between shards (1 - sub-directories of the root, also used for 0)
+        size_t shardDepth = 1;
+    };
+
+    /**
+     * @brief Shard owning a directory of a sharded walk, see WalkerOptions::shardCount
+     * @param relativePath Path to the directory relative to the root of the walk, "" for the root
+     * @param shardCount Count of shards
+     * @return Index of the shard, stable across runs and processes
+     */
+    static size_t shardOf(const std::string &relativePath, size_t shardCount);
+
+    /**
+     * @brief Directory returned by fetchBatchFromWalker()
+     */
+    struct WalkerResult
+    {
+        //! Path to the directory
+        std::string path;
+        //! Files of the directory which passed the filters
+        std::vector<std::string> files;
+    };
+
+    /**
+     * @brief Named group of files for classifyFiles()
+     */
+    struct FileGroup
+    {
+        std::string name;
+        //! list of suffix (filename ends) filters, empty to take every file
+        std::vector<std::string> suffixFilters;
+    };
+
+    /**
+     * @brief Files routed into a group by classifyFiles()
+     */
+    struct FileBucket
+    {
+        //! Name of the group, "unclassified" for the last bucket
+        std::string name;
+        //! Count of files in the bucket
+        size_t      count = 0;
+        //! Full paths of the files, filled if requested
+        std::vector<std::string> files;
+    };
+
+    /**
+     * @brief Replace the file system backend
+     * @param backend Backend to use, nullptr to return back to the native one (DirManNativeBackend)
+     *
+     * The backend is global and may be changed at any time: every call keeps the backend it has
+     * started with until it returns, and a walk keeps the backend of beginWalking() or resumeWalking() till its end.
+     * Listing, walking, snapshots, disk usage, fingerprints and directories management go through the backend.
+     * Backends have no current directory: relative paths start at the root of the backend.
+     */
+    static void setBackend(const std::shared_ptr<DirManBackend> &backend);
+
+    /**
+     * @brief Currently installed backend
+     * @return backend, the native one if no other has been installed, never nullptr
+     */
+    static std::shared_ptr<DirManBackend> backend();
+
     /**
      * @brief Change root path
      * @param dirPath absolute or relative to current application path
      */
     void     setPath(const std::string &dirPath);
 
+    /**
+     * @brief How setPath() turns the given path into the absolute one
+     */
+    enum PathResolution
+    {
+        //! Resolve symbolic links like realpath(), reusing recently resolved parent directories (default)
+        PATH_RESOLVE_CACHED = 0,
+        //! Call realpath() for every path
+        PATH_RESOLVE_STRICT,
+        //! Don't touch the file system: only collapse `.`, `..` and duplicated slashes
+        PATH_RESOLVE_LEXICAL
+    };
+
+    /**
+     * @brief Change the path resolution mode used by setPath(), clears the cache of resolved paths
+     * @param mode New mode
+     *
+     * The cached mode may return stale results if directories get replaced by symbolic links
+     * while the program runs: set the mode again to drop the cache.
+     */
+    static void setPathResolution(PathResolution mode);
+
+    /**
+     * @brief Current path resolution mode
+     */
+    static PathResolution pathResolution();
+
+    /**
+     * @brief Collapse `.`, `..` and duplicated slashes without touching the file system
+     * @param path Absolute or relative path
+     * @return Clean path, "." for an empty relative path
+     *
+     * Leading `..` of relative paths are kept, `..` of the root directory is the root directory.
+     */
+    static std::string cleanPath(const std::string &path);
+
     /**
      * @brief Get list of files in this directory
      * @param list target list to output
@@ -70,6 +376,161 @@ public:
     bool     getListOfFolders(std::vector<std::string> &list,
                               const std::vector<std::string> &suffix_filters = std::vector<std::string>());
 
+    /**
+     * @brief Get list of files in this directory, filtered by compile-time suffix filters
+     * @param list target list to output
+     * @param suffixes filters made by suffixes()
+     * @return true if success, false if any error has occouped
+     */
+    template<size_t N>
+    bool     getListOfFiles(std::vector<std::string> &list, const Suffixes<N> &suffixes)
+    {
+        return getListOfFiles(list, &filterBySuffixes<N>, &suffixes);
+    }
+
+    /**
+     * @brief Get list of directories in this directory, filtered by compile-time suffix filters
+     * @param list target list to output
+     * @param suffixes filters made by suffixes()
+     * @return true if success, false if any error has occouped
+     */
+    template<size_t N>
+    bool     getListOfFolders(std::vector<std::string> &list, const Suffixes<N> &suffixes)
+    {
+        return getListOfFolders(list, &filterBySuffixes<N>, &suffixes);
+    }
+
+    /**
+     * @brief Count files in this directory without listing them
+     * @param suffix_filters list of suffix (filename ends) filters (if not defined, count all files)
+     * @param recursive count files of sub-directories too, links to directories are not entered
+     * @return count of matching files, 0 if the directory can't be read
+     */
+    size_t   countFiles(const std::vector<std::string> &suffix_filters = std::vector<std::string>(),
+                        bool recursive = false);
+
+    /**
+     * @brief Count sub-directories of this directory without listing them
+     * @param suffix_filters list of suffix (directory name ends) filters (if not defined, count all directories)
+     * @param recursive count nested directories too, links to directories are not entered
+     * @return count of matching directories, 0 if the directory can't be read
+     */
+    size_t   countFolders(const std::vector<std::string> &suffix_filters = std::vector<std::string>(),
+                          bool recursive = false);
+
+    /**
+     * @brief Check if this directory has at least one matching file
+     * @param suffix_filters list of suffix (filename ends) filters
+     * @param recursive look into sub-directories too
+     * @return true once the first matching file has been found
+     */
+    bool     containsAny(const std::vector<std::string> &suffix_filters, bool recursive = false);
+
+    /**
+     * @brief Count files in this directory, filtered by compile-time suffix filters
+     * @param suffixes filters made by suffixes()
+     * @param recursive count files of sub-directories too
+     * @return count of matching files
+     */
+    template<size_t N>
+    size_t   countFiles(const Suffixes<N> &suffixes, bool recursive = false)
+    {
+        return countEntries(&filterBySuffixes<N>, &suffixes, false, recursive, 0);
+    }
+
+    /**
+     * @brief Count sub-directories of this directory, filtered by compile-time suffix filters
+     * @param suffixes filters made by suffixes()
+     * @param recursive count nested directories too
+     * @return count of matching directories
+     */
+    template<size_t N>
+    size_t   countFolders(const Suffixes<N> &suffixes, bool recursive = false)
+    {
+        return countEntries(&filterBySuffixes<N>, &suffixes, true, recursive, 0);
+    }
+
+    /**
+     * @brief Check if this directory has at least one file matching compile-time suffix filters
+     * @param suffixes filters made by suffixes()
+     * @param recursive look into sub-directories too
+     * @return true once the first matching file has been found
+     */
+    template<size_t N>
+    bool     containsAny(const Suffixes<N> &suffixes, bool recursive = false)
+    {
+        return countEntries(&filterBySuffixes<N>, &suffixes, false, recursive, 1) > 0;
+    }
+
+    /**
+     * @brief Position of a paginated listing, see getPageOfFiles()
+     *
+     * The position is opaque, but it may be stored and used later by another DirMan
+     * or another process to continue listing the same directory. Entries added or
+     * removed between pages may be missed or returned twice.
+     */
+    struct ListCursor
+    {
+        //! Position in the directory stream, 0 for the beginning
+        uint64_t position = 0;
+        //! The whole directory has been listed
+        bool     done = false;
+    };
+
+    /**
+     * @brief Get the next page of files in this directory
+     * @param cursor Position to continue from, advanced past the returned entries
+     * @param list target list to output, up to pageSize names
+     * @param pageSize Maximum count of names to return
+     * @param suffix_filters list of suffix (filename ends) filters (if not defined, look for all files)
+     * @return true if success, false if any error has occouped
+     *
+     * Only one page is kept in memory and the directory is read up to the end of the page,
+     * so the first page of a huge directory arrives immediately. On Linux the directory is
+     * seeked to the position, elsewhere the entries of previous pages are skipped.
+     */
+    bool     getPageOfFiles(ListCursor &cursor, std::vector<std::string> &list, size_t pageSize,
+                            const std::vector<std::string> &suffix_filters = std::vector<std::string>());
+
+    /**
+     * @brief Get the next page of directories in this directory, see getPageOfFiles()
+     * @param cursor Position to continue from, advanced past the returned entries
+     * @param list target list to output, up to pageSize names
+     * @param pageSize Maximum count of names to return
+     * @param suffix_filters list of suffix (directory name ends) filters (if not defined, look for all directories)
+     * @return true if success, false if any error has occouped
+     */
+    bool     getPageOfFolders(ListCursor &cursor, std::vector<std::string> &list, size_t pageSize,
+                              const std::vector<std::string> &suffix_filters = std::vector<std::string>());
+
+    /**
+     * @brief Get the next page of files in this directory, filtered by compile-time suffix filters
+     * @param cursor Position to continue from, advanced past the returned entries
+     * @param list target list to output, up to pageSize names
+     * @param pageSize Maximum count of names to return
+     * @param suffixes filters made by suffixes()
+     * @return true if success, false if any error has occouped
+     */
+    template<size_t N>
+    bool     getPageOfFiles(ListCursor &cursor, std::vector<std::string> &list, size_t pageSize, const Suffixes<N> &suffixes)
+    {
+        return getListPage(cursor.position, cursor.done, list, pageSize, &filterBySuffixes<N>, &suffixes, false);
+    }
+
+    /**
+     * @brief Get the next page of directories in this directory, filtered by compile-time suffix filters
+     * @param cursor Position to continue from, advanced past the returned entries
+     * @param list target list to output, up to pageSize names
+     * @param pageSize Maximum count of names to return
+     * @param suffixes filters made by suffixes()
+     * @return true if success, false if any error has occouped
+     */
+    template<size_t N>
+    bool     getPageOfFolders(ListCursor &cursor, std::vector<std::string> &list, size_t pageSize, const Suffixes<N> &suffixes)
+    {
+        return getListPage(cursor.position, cursor.done, list, pageSize, &filterBySuffixes<N>, &suffixes, true);
+    }
+
     /**
      * @brief Absolude directory path
      * @return string
@@ -88,6 +549,18 @@ public:
      */
     bool        existsRel(const std::string &dirPath);
 
+    /**
+     * @brief Find the real letter case of a relative path
+     * @param relPath Path relative to the current directory, `\\` separators are allowed
+     * @param resolved Path with the real names of every component, separated by `/`
+     * @return true if the path exists when the letter case is ignored
+     *
+     * Directories are read once: the names of each one are kept in a cache
+     * which is rebuilt when the modification time of the directory changes.
+     * If several names differ by the case only, the exactly matching one is preferred.
+     */
+    bool        resolveCaseInsensitive(const std::string &relPath, std::string &resolved);
+
     /**
      * @brief Check if any directory exists
      * @param dirPath path of directory
@@ -95,6 +568,13 @@ public:
      */
     static bool exists(const std::string &dirPath);
 
+    /**
+     * @brief Get the type name of a file system where the path is located
+     * @param path Path to any existing file or directory
+     * @return Type name (for example "ext4", "tmpfs", "nfs" or "NTFS"), or empty string if unknown
+     */
+    static std::string fileSystemType(const std::string &path);
+
     /**
      * @brief Make directory relative to current
      * @param dirPath Relative directory path
@@ -116,6 +596,18 @@ public:
      */
     bool mkpath(const std::string &dirPath = "");
 
+    /**
+     * @brief Make many directories relative to current path with making middle folders which are not exists
+     * @param paths Relative paths to the new directories, in any order, duplicates are allowed
+     * @param threads Count of threads to create independent sub-trees, 1 to use the calling thread only, 0 to pick automatically
+     * @return true if all directories exist after the call, also the ones which have existed before
+     *
+     * Paths are cleaned by cleanPath(). If any of them leads out of the current directory,
+     * nothing is created and false is returned. Shared parents are created once, each directory is created relative to its parent
+     * directory opened once where the system allows this.
+     */
+    bool mkpathMany(const std::vector<std::string> &paths, unsigned threads = 1);
+
     /**
      * @brief Recursively remove directory and all files inside it
      * @param dirPath Relative path to directory to delete
@@ -151,6 +643,150 @@ public:
      */
     static bool rmAbsPath(const std::string &dirPath);
 
+    /**
+     * @brief Disk usage summary of a directory
+     */
+    struct DiskUsage
+    {
+        //! Name of the directory (absolute path for the root)
+        std::string name;
+        //! Space allocated on the disk, includes all sub-directories
+        uint64_t    bytes = 0;
+        //! Sum of file sizes, includes all sub-directories
+        uint64_t    apparentBytes = 0;
+        //! Count of files, includes all sub-directories
+        uint64_t    files = 0;
+        //! Count of sub-directories, includes nested ones
+        uint64_t    dirs = 0;
+        //! Sub-directories
+        std::vector<DiskUsage> children;
+    };
+
+    /**
+     * @brief Recursively calculate the disk usage of this directory and every sub-directory
+     * @param out Resulting tree of directories
+     * @param threads Count of threads to use, 0 to pick automatically
+     * @return true if success, false if this directory can't be read
+     *
+     * Files having multiple hard links are counted once. Symbolic links are not followed.
+     */
+    bool diskUsage(DiskUsage &out, unsigned threads = 0);
+
+    /**
+     * @brief Content fingerprint of a file
+     */
+    struct FileFingerprint
+    {
+        //! Absolute path to the file
+        std::string path;
+        //! Size of the file in bytes
+        uint64_t    size = 0;
+        //! Modification time in nanoseconds since the Epoch
+        int64_t     mtime = 0;
+        //! Inode number (0 where not available)
+        uint64_t    inode = 0;
+        //! XXH64 hash of the file content
+        uint64_t    hash = 0;
+        //! The hash has been taken from the previous record without reading the file
+        bool        reused = false;
+    };
+
+    /**
+     * @brief Find groups of files having equal content
+     * @param files List of file fingerprints
+     * @param groups Output groups of indices in the files list, every group has two or more entries
+     */
+    static void findDuplicates(const std::vector<FileFingerprint> &files, std::vector<std::vector<size_t>> &groups);
+
+    /**
+     * @brief Snapshot of a directory tree with a Merkle-style digest per directory
+     */
+    struct TreeSnapshot
+    {
+        struct File
+        {
+            std::string name;
+            uint64_t    size = 0;
+            //! Modification time in nanoseconds since the Epoch
+            int64_t     mtime = 0;
+        };
+
+        struct Dir
+        {
+            std::string name;
+            //! Digest of names, types, sizes and modification times of all files and sub-directories
+            uint64_t    digest = 0;
+            //! Inode number of the directory, 0 where not available
+            uint64_t    inode = 0;
+            //! Modification time of the directory itself in nanoseconds since the Epoch, 0 where not available
+            int64_t     mtime = 0;
+            //! Status change time of the directory in nanoseconds since the Epoch, 0 where not available
+            int64_t     ctime = 0;
+            //! Files sorted by name
+            std::vector<File> files;
+            //! Sub-directories sorted by name
+            std::vector<Dir>  dirs;
+        };
+
+        Dir root;
+        //! Time when taking of the snapshot has been started, in nanoseconds since the Epoch
+        int64_t taken = 0;
+    };
+
+    /**
+     * @brief Change between two tree snapshots
+     */
+    struct TreeChange
+    {
+        enum Type
+        {
+            ADDED = 0,
+            REMOVED,
+            MODIFIED
+        };
+
+        Type        type = ADDED;
+        //! Path relative to the snapshot root
+        std::string path;
+        bool        isDir = false;
+    };
+
+    /**
+     * @brief Take a snapshot of this directory tree
+     * @param out Resulting snapshot
+     * @return true if success, false if this directory can't be read
+     */
+    bool takeSnapshot(TreeSnapshot &out);
+
+    /**
+     * @brief Find differences between two snapshots
+     * @param from Old snapshot
+     * @param to New snapshot
+     * @param changes List of added, removed and modified entries
+     *
+     * Sub-directories with equal digests are skipped, so the cost depends on the count of changes only.
+     * Content of added and removed directories is reported entry by entry.
+     */
+    static void diffSnapshots(const TreeSnapshot &from, const TreeSnapshot &to, std::vector<TreeChange> &changes);
+
+    /**
+     * @brief Take a new snapshot of this directory tree, reading only changed directories
+     * @param previous Snapshot of this tree taken before
+     * @param out Resulting snapshot, must not be the previous one
+     * @param changes Differences between the previous snapshot and the new one, see diffSnapshots()
+     * @param statFiles Check sizes and modification times of files in unchanged directories
+     * @param readDirs If set, receives the count of directories which have been read
+     * @return true if success, false if this directory can't be read
+     *
+     * Every directory is checked by a single stat: if its inode, modification and status change
+     * times are unchanged, the listing of the previous snapshot is reused instead of reading it.
+     * Directories changed shortly before the previous snapshot are read anyway, because their times
+     * can't tell later changes apart. Changes of file content keep the directory times, so they are
+     * only found with statFiles, which takes a stat per file.
+     */
+    bool rescanSnapshot(const TreeSnapshot &previous, TreeSnapshot &out, std::vector<TreeChange> &changes,
+                        bool statFiles = false, size_t *readDirs = nullptr);
+
 #ifndef PGE_FILES_PRESENT
     /**
      * @brief Starts directory walking
@@ -159,6 +795,15 @@ public:
      */
     bool        beginWalking(const std::vector<std::string> &suffix_filters = std::vector<std::string>());
 
+    /**
+     * @brief Starts directory walking with custom settings
+     * @param options walker settings (directory pruning rules, etc.)
+     * @param suffix_filters list of suffix (filename ends) filters (if not defined, look for all files)
+     * @return true if Walker successfully initialized
+     */
+    bool        beginWalking(const WalkerOptions &options,
+                             const std::vector<std::string> &suffix_filters = std::vector<std::string>());
+
     /**
      * @brief Fetch list of files of the next directory
      * @param curPath Current directory path
@@ -166,6 +811,125 @@ public:
      * @return false when directory walking has been completed
      */
     bool        fetchListFromWalker(std::string &curPath, std::vector<std::string> &list);
+
+    /**
+     * @brief Fetch lists of files of several next directories at once
+     * @param results Buffer to fill, reused between calls: filled results are placed at the beginning,
+     *                the rest of elements keep their memory for next calls
+     * @param maxEntries Stop adding directories once this count of directories and files is reached, 0 for unlimited
+     * @param maxBytes Stop adding directories once paths and file names take this count of bytes, 0 for unlimited
+     * @return Count of filled results, 0 when directory walking has been completed
+     *
+     * Directories are never split between batches, so the last one may exceed the limits.
+     * The file system lock is taken once per batch instead of once per directory.
+     */
+    size_t      fetchBatchFromWalker(std::vector<WalkerResult> &results, size_t maxEntries, size_t maxBytes = 0);
+
+    /**
+     * @brief Save the state of the running walk
+     * @param checkpoint Compact binary state: pending directories, filters, options and counters
+     * @return false if the walk can't be saved
+     *
+     * The directory returned by the last fetchListFromWalker() call is not a part of the state:
+     * save the checkpoint once its files have been processed. The cost depends on the count of
+     * pending directories only (plus directories entered through symbolic links), so checkpoints
+     * can be taken every few seconds. WalkerOptions::pruneCallback can't be saved.
+     */
+    bool        saveWalkerCheckpoint(std::string &checkpoint) const;
+
+    /**
+     * @brief Hand off about a half of the remaining walk to another walker
+     * @param other Walker to start, its previous walk gets dropped
+     * @return false if there are less than two pending directories to share, the other walker is untouched then
+     *
+     * The other walker gets the root path, the filters, the options and a half of the remaining
+     * maxEntries and maxDirectories budgets, then both walkers continue independently and may be
+     * drained by different threads. Directories already read ahead stay with this walker.
+     * WalkerOptions::pruneCallback is shared, so it must be thread-safe.
+     * With followSymlinks, both walkers share the set of linked directories they entered,
+     * so a directory linked from both halves is entered by one of them only.
+     */
+    bool        splitWalker(DirMan &other);
+
+    /**
+     * @brief Continue the walk from a saved state
+     * @param checkpoint State saved by saveWalkerCheckpoint(), the root directory gets restored too
+     * @param pruneCallback Custom rule to skip directories, see WalkerOptions::pruneCallback
+     * @return false if the checkpoint is damaged
+     */
+    bool        resumeWalking(const std::string &checkpoint,
+                              const std::function<bool(const std::string &parentPath, const std::string &name)> &pruneCallback = nullptr);
+
+    /**
+     * @brief Recursively hash the content of all files in this directory
+     * @param out List of fingerprints sorted by the path
+     * @param previous Fingerprints of a previous run: files with unchanged size, modification time and inode are not read again
+     * @param suffix_filters list of suffix (filename ends) filters (if not defined, hash all files)
+     * @param threads Count of hashing threads, 0 to pick automatically
+     * @return true if success
+     *
+     * Files get hashed by a pool of threads while the directory walk is still in progress.
+     */
+    bool        fingerprintFiles(std::vector<FileFingerprint> &out,
+                                 const std::vector<FileFingerprint> &previous = std::vector<FileFingerprint>(),
+                                 const std::vector<std::string> &suffix_filters = std::vector<std::string>(),
+                                 unsigned threads = 0);
+
+    /**
+     * @brief Recursively hash the content of files in this directory with custom walker settings
+     * @param out List of fingerprints sorted by the path
+     * @param options walker settings
+     * @param previous Fingerprints of a previous run: files with unchanged size, modification time and inode are not read again
+     * @param suffix_filters list of suffix (filename ends) filters (if not defined, hash all files)
+     * @param threads Count of hashing threads, 0 to pick automatically
+     * @return true if success
+     */
+    bool        fingerprintFiles(std::vector<FileFingerprint> &out,
+                                 const WalkerOptions &options,
+                                 const std::vector<FileFingerprint> &previous = std::vector<FileFingerprint>(),
+                                 const std::vector<std::string> &suffix_filters = std::vector<std::string>(),
+                                 unsigned threads = 0);
+
+    /**
+     * @brief Sort files of this directory tree into several groups with a single walk
+     * @param buckets One bucket per group in the same order, plus the "unclassified" bucket at the end
+     * @param groups Named groups of suffix filters, a file gets into every group it matches
+     * @param collectPaths Fill the lists of paths, otherwise only count files
+     * @return true if success, false if this directory can't be walked
+     */
+    bool        classifyFiles(std::vector<FileBucket> &buckets,
+                              const std::vector<FileGroup> &groups,
+                              bool collectPaths = true);
+
+    /**
+     * @brief Sort files of this directory tree into several groups with custom walker settings
+     * @param buckets One bucket per group in the same order, plus the "unclassified" bucket at the end
+     * @param groups Named groups of suffix filters, a file gets into every group it matches
+     * @param options walker settings
+     * @param collectPaths Fill the lists of paths, otherwise only count files
+     * @return true if success, false if this directory can't be walked
+     */
+    bool        classifyFiles(std::vector<FileBucket> &buckets,
+                              const std::vector<FileGroup> &groups,
+                              const WalkerOptions &options,
+                              bool collectPaths = true);
+
+    /**
+     * @brief Check that the shards of a sharded walk cover this tree completely and don't overlap
+     * @param options walker settings used by the shards, shard settings are ignored
+     * @param shardFiles Full paths of files returned by every shard
+     * @param missing Files of the tree which no shard has returned
+     * @param duplicated Files returned more than once
+     * @param suffix_filters list of suffix (filename ends) filters used by the shards
+     * @return true if every file has been returned exactly once
+     *
+     * Walks the whole tree again, so the tree must not change since the shards have been walked.
+     */
+    bool        verifyShardCoverage(const WalkerOptions &options,
+                                    const std::vector<std::vector<std::string> > &shardFiles,
+                                    std::vector<std::string> &missing,
+                                    std::vector<std::string> &duplicated,
+                                    const std::vector<std::string> &suffix_filters = std::vector<std::string>());
 #endif // #ifndef PGE_FILES_PRESENT
 };
 
@@ -0,0 +1,164 @@
+/*
+ * DirMan - A small crossplatform class to manage directories
+ *
+ * Copyright (c) 2017-2026 Vitaliy Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DIRMAN_ASYNC_H
+#define DIRMAN_ASYNC_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "dirman.h"
+
+/**
+ * @brief Non-blocking variants of slow DirMan calls
+ *
+ * Jobs are queued to an internal pool with a limited count of worker threads.
+ * Callbacks are called once per job on the worker thread, also when the job
+ * has been cancelled. Without threading support (PGE_NO_THREADING or PGE_SDL_MUTEX)
+ * jobs run on the calling thread before the call returns.
+ */
+class DirManAsync
+{
+public:
+    struct TaskState;
+
+    /**
+     * @brief Handle of a queued job, also serves as its cancellation token
+     */
+    class Task
+    {
+        friend class DirManAsync;
+        std::shared_ptr<TaskState> m_state;
+    public:
+        //! The handle refers to a job
+        bool    isValid() const;
+        //! The job has been completed or cancelled, its callback has returned
+        bool    isFinished() const;
+        //! Block until the job gets finished
+        void    wait() const;
+        /**
+         * @brief Request the job to stop
+         *
+         * Queued jobs don't start, running ones stop at the next processed entry.
+         * Partially removed trees stay partially removed.
+         */
+        void    cancel();
+        bool    isCancelled() const;
+        //! Count of entries processed so far: removed files and directories, or read directories
+        size_t  progress() const;
+        //! The job has been finished successfully
+        bool    succeeded() const;
+    };
+
+    //! Result of a job
+    typedef std::function<void(bool ok)> DoneCallback;
+    //! Result of a listing job, the list may be taken by swap()
+    typedef std::function<void(bool ok, std::vector<std::string> &list)> ListCallback;
+    //! Called on the worker thread after every processed entry
+    typedef std::function<void(size_t processed)> ProgressCallback;
+
+    /**
+     * @brief Get list of files of the directory, see DirMan::getListOfFiles()
+     * @param dirPath Absolute path to the directory
+     * @param suffix_filters list of suffix (filename ends) filters (if not defined, look for all files)
+     * @param done Receives the list of file names
+     * @return handle of the job
+     */
+    static Task getListOfFiles(const std::string &dirPath,
+                               const std::vector<std::string> &suffix_filters,
+                               const ListCallback &done);
+
+    /**
+     * @brief Get list of sub-directories of the directory, see DirMan::getListOfFolders()
+     * @param dirPath Absolute path to the directory
+     * @param suffix_filters list of suffix (directory name ends) filters (if not defined, look for all directories)
+     * @param done Receives the list of directory names
+     * @return handle of the job
+     */
+    static Task getListOfFolders(const std::string &dirPath,
+                                 const std::vector<std::string> &suffix_filters,
+                                 const ListCallback &done);
+
+#ifndef PGE_FILES_PRESENT
+    /**
+     * @brief Walk the directory tree, see DirMan::beginWalking()
+     * @param dirPath Absolute path to the root directory
+     * @param options walker settings
+     * @param suffix_filters list of suffix (filename ends) filters (if not defined, look for all files)
+     * @param done Receives full paths of the found files
+     * @param progress Receives the count of read directories
+     * @return handle of the job
+     */
+    static Task walk(const std::string &dirPath,
+                     const DirMan::WalkerOptions &options,
+                     const std::vector<std::string> &suffix_filters,
+                     const ListCallback &done,
+                     const ProgressCallback &progress = nullptr);
+#endif
+
+    /**
+     * @brief Create the directory with all missing parents, see DirMan::mkAbsPath()
+     * @param dirPath Absolute path to the directory
+     * @param done Receives the result
+     * @return handle of the job
+     */
+    static Task mkAbsPath(const std::string &dirPath, const DoneCallback &done = nullptr);
+
+    /**
+     * @brief Remove the directory with all its content, see DirMan::rmAbsPath()
+     * @param dirPath Absolute path to the directory
+     * @param done Receives the result
+     * @param progress Receives the count of removed files and directories
+     * @return handle of the job
+     */
+    static Task rmAbsPath(const std::string &dirPath,
+                          const DoneCallback &done = nullptr,
+                          const ProgressCallback &progress = nullptr);
+
+    /**
+     * @brief Limit the count of worker threads
+     * @param threads Maximum count of threads, 0 to pick automatically
+     *
+     * Threads are started on demand and are kept until shutdown().
+     */
+    static void     setMaxThreads(unsigned threads);
+    static unsigned maxThreads();
+
+    /**
+     * @brief Cancel all jobs and stop worker threads
+     *
+     * Waits for running jobs to stop. New jobs start the pool again.
+     * Call it before leaving main(): the pool is never destroyed, so worker threads
+     * still running at exit are not joined and their jobs get no result.
+     */
+    static void     shutdown();
+
+private:
+    //! Queue the job, or run it right now without threading support
+    static Task     start(std::shared_ptr<TaskState> &&job);
+};
+
+#endif // DIRMAN_ASYNC_H
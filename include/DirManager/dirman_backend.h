@@ -0,0 +1,200 @@
+/*
+ * DirMan - A small crossplatform class to manage directories
+ *
+ * Copyright (c) 2017-2026 Vitaliy Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DIRMAN_BACKEND_H
+#define DIRMAN_BACKEND_H
+
+#include <string>
+#include <memory>
+#include <stdint.h>
+
+/**
+ * @brief Run-time file system backend used by DirMan
+ *
+ * DirManNativeBackend is used by default, install another one by DirMan::setBackend()
+ * to replace it. All paths are absolute and UTF-8 encoded. Walks may call the backend
+ * from reading threads, and disk usage and fingerprints from several threads at once.
+ */
+class DirManBackend
+{
+public:
+    enum EntryType
+    {
+        //! Type is not known, stat() is required
+        ENTRY_UNKNOWN = 0,
+        ENTRY_FILE,
+        ENTRY_DIR,
+        ENTRY_OTHER
+    };
+
+    struct Entry
+    {
+        std::string name;
+        EntryType   type = ENTRY_UNKNOWN;
+    };
+
+    struct Stat
+    {
+        EntryType   type = ENTRY_UNKNOWN;
+        uint64_t    size = 0;
+        //! Modification time in nanoseconds since the Epoch
+        int64_t     mtime = 0;
+        uint64_t    device = 0;
+        uint64_t    inode = 0;
+        //! Status change time in nanoseconds since the Epoch, 0 where not available
+        int64_t     ctime = 0;
+    };
+
+    typedef void *DirHandle;
+
+    virtual ~DirManBackend();
+
+    /**
+     * @brief Open the directory for reading
+     * @return handle of the opened directory, nullptr on error
+     */
+    virtual DirHandle openDir(const std::string &path) = 0;
+
+    /**
+     * @brief Read the next entry of the directory, "." and ".." are never returned
+     * @return false if there are no more entries
+     */
+    virtual bool readDir(DirHandle dir, Entry &entry) = 0;
+
+    virtual void closeDir(DirHandle dir) = 0;
+
+    /**
+     * @brief Get details of the entry, symbolic links are followed
+     * @return false if the entry doesn't exist
+     */
+    virtual bool stat(const std::string &path, Stat &st) = 0;
+
+    /**
+     * @brief Get details of the entry just returned by readDir(), symbolic links are followed
+     * @param dir Handle the entry has been read from
+     * @param dirPath Path to the directory of the handle
+     * @param entry The entry
+     * @return false if the entry doesn't exist anymore
+     *
+     * Calls stat() by default, backends may use the opened directory to get them cheaper.
+     */
+    virtual bool statEntry(DirHandle dir, const std::string &dirPath, const Entry &entry, Stat &st);
+
+    virtual bool mkdir(const std::string &path) = 0;
+    virtual bool rmdir(const std::string &path) = 0;
+    virtual bool unlink(const std::string &path) = 0;
+
+    /**
+     * @brief Read the whole content of a file (ignore rule files and fingerprints)
+     * @return false if the file can't be read or if the backend doesn't support this
+     */
+    virtual bool readFile(const std::string &path, std::string &data);
+};
+
+/**
+ * @brief Native file system of the platform (POSIX, Windows or Vita), the default backend
+ *
+ * While the default instance returned by DirMan::backend() is installed, DirMan calls the
+ * platform code of every feature directly. Other instances, subclasses included, are called
+ * through this interface like any other backend.
+ */
+class DirManNativeBackend : public DirManBackend
+{
+public:
+    DirHandle openDir(const std::string &path) override;
+    bool readDir(DirHandle dir, Entry &entry) override;
+    void closeDir(DirHandle dir) override;
+    bool stat(const std::string &path, Stat &st) override;
+    bool statEntry(DirHandle dir, const std::string &dirPath, const Entry &entry, Stat &st) override;
+    bool mkdir(const std::string &path) override;
+    bool rmdir(const std::string &path) override;
+    bool unlink(const std::string &path) override;
+    bool readFile(const std::string &path, std::string &data) override;
+};
+
+/**
+ * @brief In-memory file system tree with configurable latency of every operation
+ *
+ * Useful to benchmark algorithms deterministically and to simulate slow storages.
+ * The latency is either really waited or only summed into the simulated time.
+ */
+class DirManMemoryBackend : public DirManBackend
+{
+    struct Impl;
+    std::unique_ptr<Impl> p;
+
+public:
+    enum Operation
+    {
+        OP_OPEN_DIR = 0,
+        OP_READ_DIR,
+        OP_STAT,
+        OP_MKDIR,
+        OP_RMDIR,
+        OP_UNLINK,
+        OP_READ_FILE,
+        OP_COUNT
+    };
+
+    DirManMemoryBackend();
+    ~DirManMemoryBackend() override;
+
+    /**
+     * @brief Create a file, missing parent directories are created too
+     * @param path Absolute path to the file
+     * @param data Content of the file
+     * @param mtime Modification time in nanoseconds since the Epoch
+     * @return false if the path is occupied by a directory
+     */
+    bool addFile(const std::string &path, const std::string &data = std::string(), int64_t mtime = 0);
+
+    /**
+     * @brief Set the latency of the operation
+     * @param op Operation
+     * @param microseconds Latency in microseconds
+     */
+    void setLatency(Operation op, uint32_t microseconds);
+
+    /**
+     * @brief Really wait for the latency, otherwise it's only added to the simulated time
+     */
+    void setRealDelays(bool enabled);
+
+    //! Sum of all latencies of performed operations in microseconds
+    uint64_t simulatedTime() const;
+    //! Count of performed operations of the given kind
+    uint64_t operationsCount(Operation op) const;
+    void     resetCounters();
+
+    DirHandle openDir(const std::string &path) override;
+    bool readDir(DirHandle dir, Entry &entry) override;
+    void closeDir(DirHandle dir) override;
+    bool stat(const std::string &path, Stat &st) override;
+    bool mkdir(const std::string &path) override;
+    bool rmdir(const std::string &path) override;
+    bool unlink(const std::string &path) override;
+    bool readFile(const std::string &path, std::string &data) override;
+};
+
+#endif // DIRMAN_BACKEND_H
@@ -22,8 +22,17 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <unordered_map>
+#include <algorithm>
+#include <iterator>
+#include <locale>
+#include <chrono>
+
 #include "../include/DirManager/dirman.h"
 #include "dirman_private.h"
+#include "dirman_workqueue.h"
+#include "dirman_hash.h"
+#include "dirman_pathbuilder.h"
 
 #ifdef PGE_FILES_PRESENT
 #    include "Utils/files.h"
@@ -42,22 +51,35 @@ bool DirMan::matchSuffixFilters(const std::string &name, const std::vector<std::
     return false;
 }
 
+bool DirMan::matchSuffixFilters(const char *name, size_t length, const std::vector<std::string> &suffixFilters)
+{
+    if(suffixFilters.empty())
+        return true;
+
+    return matchSuffixFilters(std::string(name, length), suffixFilters);
+}
+
 #else
 #    include <locale>
 
 bool DirMan::matchSuffixFilters(const std::string &name, const std::vector<std::string> &suffixFilters)
 {
-    std::locale loc;
+    return matchSuffixFilters(name.data(), name.size(), suffixFilters);
+}
 
+bool DirMan::matchSuffixFilters(const char *name, size_t length, const std::vector<std::string> &suffixFilters)
+{
     if(suffixFilters.empty())
         return true;//If no filter, grand everything
 
+    std::locale loc;
+
     for(const std::string &suffix : suffixFilters)
     {
-        if(suffix.size() > name.size())
+        if(suffix.size() > length)
             continue;
 
-        const char* name_compare = &name[name.size() - suffix.size()];
+        const char* name_compare = name + length - suffix.size();
 
         bool match = true;
         for(size_t i = 0; i < suffix.size(); ++i)
@@ -77,6 +99,110 @@ bool DirMan::matchSuffixFilters(const std::string &name, const std::vector<std::
 }
 #endif // #ifdef PGE_FILES_PRESENT
 
+bool DirMan::matchSuffixHead(const char *name, size_t length, const char *suffix, size_t suffixLength)
+{
+    // The last 8 characters are already compared
+    const char *n = name + length - suffixLength;
+    for(size_t i = 0; i < suffixLength - 8; ++i)
+    {
+        if(foldAscii(n[i]) != foldAscii(suffix[i]))
+            return false;
+    }
+
+    return true;
+}
+
+static bool matchGlobClass(const char *&p, char c)
+{
+    // p points after the opening '['
+    bool negate = false;
+    bool match = false;
+
+    if(*p == '!' || *p == '^')
+    {
+        negate = true;
+        p++;
+    }
+
+    const char *start = p;
+    while(*p && (*p != ']' || p == start))
+    {
+        if(p[1] == '-' && p[2] && p[2] != ']')
+        {
+            if(c >= p[0] && c <= p[2])
+                match = true;
+            p += 3;
+        }
+        else
+        {
+            if(c == *p)
+                match = true;
+            p++;
+        }
+    }
+
+    if(*p == ']')
+        p++;
+
+    return match != negate;
+}
+
+bool DirMan::matchGlob(const std::string &name, const std::string &pattern)
+{
+    const char *n = name.c_str();
+    const char *p = pattern.c_str();
+    const char *starP = nullptr;
+    const char *starN = nullptr;
+
+    while(*n)
+    {
+        if(*p == '*')
+        {
+            // Remember the position to retry from on a mismatch
+            starP = ++p;
+            starN = n;
+            continue;
+        }
+
+        const char *next = p;
+        bool match = false;
+
+        if(*p == '?')
+        {
+            match = true;
+            next = p + 1;
+        }
+        else if(*p == '[')
+        {
+            next = p + 1;
+            match = matchGlobClass(next, *n);
+        }
+        else if(*p)
+        {
+            match = (*p == *n);
+            next = p + 1;
+        }
+
+        if(match)
+        {
+            p = next;
+            n++;
+        }
+        else if(starP)
+        {
+            p = starP;
+            n = ++starN;
+        }
+        else
+            return false;
+    }
+
+    while(*p == '*')
+        p++;
+
+    return *p == '\0';
+}
+
 DirMan::DirMan(const std::string &dirPath) :
     d(new DirMan_private)
 {
@@ -86,25 +212,213 @@ DirMan::DirMan(const std::string &dirPath) :
 DirMan::DirMan(const DirMan &dir) :
     d(new DirMan_private)
 {
-    setPath(dir.d->m_dirPath);
+    // The path is already resolved
+    d->m_dirPath = dir.d->m_dirPath;
+#ifdef _WIN32
+    d->m_dirPathW = dir.d->m_dirPathW;
+#endif
 }
 
 DirMan::~DirMan()
-{}
+{
+    d->stopPrefetch();
+}
 
 void DirMan::setPath(const std::string &dirPath)
 {
+    if(!DirMan_private::isNative(*DirMan_private::backend()))
+    {
+        d->m_dirPath = DirMan_private::backendAbsPath(dirPath);
+#ifdef _WIN32
+        d->m_dirPathW = DirMan_private::toPathString(d->m_dirPath);
+#endif
+        return;
+    }
+
     d->setPath(dirPath);
 }
 
+DirMan::PathResolution DirMan::DirMan_private::s_pathResolution = DirMan::PATH_RESOLVE_CACHED;
+
+void DirMan::setPathResolution(PathResolution mode)
+{
+    DirMan_private::s_pathResolution = mode;
+    DirMan_private::clearPathCache();
+}
+
+DirMan::PathResolution DirMan::pathResolution()
+{
+    return DirMan_private::s_pathResolution;
+}
+
+std::string DirMan::cleanPath(const std::string &path)
+{
+    std::string prefix;
+    size_t i = 0;
+
+#ifdef _WIN32
+    // Keep the drive letter
+    if(path.size() >= 2 && path[1] == ':')
+    {
+        prefix = path.substr(0, 2);
+        i = 2;
+    }
+#   define DIRMAN_IS_SLASH(c) ((c) == '/' || (c) == '\\')
+#else
+#   define DIRMAN_IS_SLASH(c) ((c) == '/')
+#endif
+
+    const bool rooted = i < path.size() && DIRMAN_IS_SLASH(path[i]);
+    if(rooted)
+        prefix.push_back('/');
+
+    std::string out;
+    out.reserve(path.size());
+    // Count of leading ".." components kept in the output of a relative path
+    size_t ups = 0;
+
+    while(i < path.size())
+    {
+        while(i < path.size() && DIRMAN_IS_SLASH(path[i]))
+            i++;
+
+        size_t begin = i;
+        while(i < path.size() && !DIRMAN_IS_SLASH(path[i]))
+            i++;
+
+        size_t len = i - begin;
+        if(len == 0 || (len == 1 && path[begin] == '.'))
+            continue;
+
+        if(len == 2 && path[begin] == '.' && path[begin + 1] == '.')
+        {
+            if(out.size() > (ups > 0 ? ups * 3 - 1 : 0))
+            {
+                // Drop the last component
+                size_t slash = out.find_last_of('/');
+                out.resize(slash == std::string::npos ? 0 : slash);
+            }
+            else if(!rooted)
+            {
+                if(!out.empty())
+                    out.push_back('/');
+                out.append("..");
+                ups++;
+            }
+            continue;
+        }
+
+        if(!out.empty())
+            out.push_back('/');
+        out.append(path, begin, len);
+    }
+
+#undef DIRMAN_IS_SLASH
+
+    if(out.empty() && prefix.empty())
+        return ".";
+
+    return prefix + out;
+}
+
 bool DirMan::getListOfFiles(std::vector<std::string> &list, const std::vector<std::string> &suffix_filters)
 {
-    return d->getListOfFiles(list, suffix_filters);
+    DirManNameFilter filter(suffix_filters);
+    return getListOfFiles(list, filter.func, filter.context);
 }
 
 bool DirMan::getListOfFolders(std::vector<std::string> &list, const std::vector<std::string> &suffix_filters)
 {
-    return d->getListOfFolders(list, suffix_filters);
+    DirManNameFilter filter(suffix_filters);
+    return getListOfFolders(list, filter.func, filter.context);
+}
+
+bool DirMan::getListOfFiles(std::vector<std::string> &list, bool (*filter)(const void *, const char *, size_t), const void *context)
+{
+    DirManNameFilter f(filter, context);
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return d->backendGetList(*b, list, f, false);
+
+    return d->getListOfFiles(list, f);
+}
+
+bool DirMan::getListOfFolders(std::vector<std::string> &list, bool (*filter)(const void *, const char *, size_t), const void *context)
+{
+    DirManNameFilter f(filter, context);
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return d->backendGetList(*b, list, f, true);
+
+    return d->getListOfFolders(list, f);
+}
+
+size_t DirMan::countFiles(const std::vector<std::string> &suffix_filters, bool recursive)
+{
+    DirManNameFilter filter(suffix_filters);
+    return countEntries(filter.func, filter.context, false, recursive, 0);
+}
+
+size_t DirMan::countFolders(const std::vector<std::string> &suffix_filters, bool recursive)
+{
+    DirManNameFilter filter(suffix_filters);
+    return countEntries(filter.func, filter.context, true, recursive, 0);
+}
+
+bool DirMan::containsAny(const std::vector<std::string> &suffix_filters, bool recursive)
+{
+    DirManNameFilter filter(suffix_filters);
+    return countEntries(filter.func, filter.context, false, recursive, 1) > 0;
+}
+
+size_t DirMan::countEntries(bool (*filter)(const void *, const char *, size_t), const void *context,
+                            bool folders, bool recursive, size_t limit)
+{
+    DirManNameFilter f(filter, context);
+    DirManCountQuery query(f, folders, recursive, limit);
+
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        d->backendCountEntries(*b, query);
+    else
+        d->countEntries(query);
+
+    return query.count;
+}
+
+bool DirMan::getPageOfFiles(ListCursor &cursor, std::vector<std::string> &list, size_t pageSize,
+                            const std::vector<std::string> &suffix_filters)
+{
+    DirManNameFilter filter(suffix_filters);
+    return getListPage(cursor.position, cursor.done, list, pageSize, filter.func, filter.context, false);
+}
+
+bool DirMan::getPageOfFolders(ListCursor &cursor, std::vector<std::string> &list, size_t pageSize,
+                              const std::vector<std::string> &suffix_filters)
+{
+    DirManNameFilter filter(suffix_filters);
+    return getListPage(cursor.position, cursor.done, list, pageSize, filter.func, filter.context, true);
+}
+
+bool DirMan::getListPage(uint64_t &position, bool &done, std::vector<std::string> &list, size_t pageSize,
+                         bool (*filter)(const void *, const char *, size_t), const void *context, bool folders)
+{
+    list.clear();
+
+    if(done)
+        return true;
+
+    if(pageSize == 0)
+        pageSize = 1;
+
+    DirManNameFilter f(filter, context);
+    DirManListPage page(f, list, position, done, folders, pageSize);
+
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return d->backendGetListPage(*b, page);
+
+    return d->getListPage(page);
 }
 
 std::string DirMan::absolutePath()
@@ -119,63 +433,1999 @@ bool DirMan::exists()
 
 bool DirMan::existsRel(const std::string &dirPath)
 {
-    return exists(d->m_dirPath + "/" + dirPath);
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return DirMan_private::backendExists(*b, d->m_dirPath + "/" + dirPath);
+
+    DirManPathBuilder path(d->m_dirPath);
+    path.push(dirPath);
+    return DirMan_private::exists(path.c_str());
+}
+
+bool DirMan::resolveCaseInsensitive(const std::string &relPath, std::string &resolved)
+{
+    return DirMan_private::resolveCaseInsensitive(d->m_dirPath, relPath, resolved);
+}
+
+/*
+ * Case-folded names of recently looked up directories
+ */
+struct CaseFoldedName
+{
+    std::string real;
+    //! Several names of the directory have this folded form
+    bool        ambiguous = false;
+};
+
+struct CaseFoldedDir
+{
+    int64_t mtime = 0;
+    //! The directory was modified too shortly before it was read to trust its modification time
+    bool    racy = false;
+    std::unordered_map<std::string, CaseFoldedName> names;
+};
+
+static std::unordered_map<std::string, std::shared_ptr<CaseFoldedDir> > s_caseFoldedDirs;
+static const size_t s_caseFoldedDirsMax = 1024;
+//! Modification times are coarse (up to 2 seconds on FAT): changes made within this time may keep them equal
+static const int64_t s_caseFoldedRacyNs = 2000000000LL;
+
+//! Fold ASCII letters only, like suffix filters: the result must not depend on the locale
+static void foldCase(std::string &name)
+{
+    for(char &c : name)
+    {
+        if(c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c + ('a' - 'A'));
+    }
+}
+
+void DirMan::DirMan_private::clearCaseCache()
+{
+    PUT_THREAD_GUARD();
+    s_caseFoldedDirs.clear();
+}
+
+bool DirMan::DirMan_private::resolveCaseInsensitive(const std::string &root, const std::string &relPath, std::string &resolved)
+{
+    std::shared_ptr<DirManBackend> b = backend();
+    EntryInfo info;
+    std::vector<std::string> names;
+    std::string cur = root;
+    std::string name, folded;
+
+    resolved.clear();
+
+    // Most of paths are already correct: check the exact one first
+    std::string exact = relPath;
+    std::replace(exact.begin(), exact.end(), '\\', '/');
+    exact = cleanPath(exact);
+    if(statPath(*b, root + "/" + exact, info))
+    {
+        resolved = exact;
+        return true;
+    }
+
+    size_t i = 0;
+    while(i < exact.size())
+    {
+        size_t slash = exact.find('/', i);
+        if(slash == std::string::npos)
+            slash = exact.size();
+        name.assign(exact, i, slash - i);
+        i = slash + 1;
+
+        if(name.empty() || name == ".")
+            continue;
+
+        // Only leading ".." components are left by cleanPath()
+        if(name == "..")
+        {
+            cur = cleanPath(cur + "/..");
+            resolved += resolved.empty() ? ".." : "/..";
+            continue;
+        }
+
+        // The modification time of a directory changes when its entries get added, removed or renamed
+        if(!statPath(*b, cur, info) || !info.isDir)
+            return false;
+
+        // The lock is held only to access the cache: other calls must not wait for the I/O
+        std::shared_ptr<CaseFoldedDir> dir;
+        {
+            PUT_THREAD_GUARD();
+            auto it = s_caseFoldedDirs.find(cur);
+            if(it != s_caseFoldedDirs.end())
+                dir = it->second;
+        }
+
+        // Unknown modification time can't be checked, such directories are read every time
+        if(!dir || dir->racy || dir->mtime != info.mtime || info.mtime == 0)
+        {
+            if(!listNames(*b, cur, names))
+                return false;
+
+            dir = std::make_shared<CaseFoldedDir>();
+            dir->mtime = info.mtime;
+            int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::system_clock::now().time_since_epoch()).count();
+            dir->racy = info.mtime > now - s_caseFoldedRacyNs;
+            dir->names.reserve(names.size());
+            for(std::string &n : names)
+            {
+                folded = n;
+                foldCase(folded);
+                CaseFoldedName &f = dir->names[folded];
+                if(f.real.empty())
+                    f.real = std::move(n);
+                else
+                    f.ambiguous = true;
+            }
+
+            PUT_THREAD_GUARD();
+            if(s_caseFoldedDirs.size() >= s_caseFoldedDirsMax)
+                s_caseFoldedDirs.clear();
+            s_caseFoldedDirs[cur] = dir;
+        }
+
+        folded = name;
+        foldCase(folded);
+        auto found = dir->names.find(folded);
+        if(found == dir->names.end())
+            return false;
+
+        const std::string *real = &found->second.real;
+        // Several names differ by the case only: prefer the exact one
+        if(found->second.ambiguous && *real != name &&
+           statPath(*b, cur + "/" + name, info))
+            real = &name;
+
+        cur.push_back('/');
+        cur.append(*real);
+        if(!resolved.empty())
+            resolved.push_back('/');
+        resolved.append(*real);
+    }
+
+    return true;
+}
+
+bool DirMan::exists(const std::string &dirPath)
+{
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return DirMan_private::backendExists(*b, dirPath);
+
+    return DirMan_private::exists(dirPath.c_str());
+}
+
+std::string DirMan::fileSystemType(const std::string &path)
+{
+    // Backends have no mount points
+    if(!DirMan_private::isNative(*DirMan_private::backend()))
+        return std::string();
+
+    return DirMan_private::fileSystemType(path);
 }
 
 bool DirMan::mkdir(const std::string &dirPath)
 {
-    return mkAbsDir(d->m_dirPath + "/" + dirPath);
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return b->mkdir(d->m_dirPath + "/" + dirPath);
+
+    DirManPathBuilder path(d->m_dirPath);
+    path.push(dirPath);
+    return DirMan_private::mkAbsDir(path.c_str());
 }
 
 bool DirMan::rmdir(const std::string &dirPath)
 {
-    return rmAbsDir(d->m_dirPath + "/" + dirPath);
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return b->rmdir(d->m_dirPath + "/" + dirPath);
+
+    DirManPathBuilder path(d->m_dirPath);
+    path.push(dirPath);
+    return DirMan_private::rmAbsDir(path.c_str());
 }
 
 bool DirMan::mkpath(const std::string &dirPath)
 {
-    return mkAbsPath(d->m_dirPath + "/" + dirPath);
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return DirMan_private::backendMkAbsPath(*b, d->m_dirPath + "/" + dirPath);
+
+    DirManPathBuilder path(d->m_dirPath);
+    path.push(dirPath);
+    return DirMan_private::mkAbsPath(path.c_str());
 }
 
 bool DirMan::rmpath(const std::string &dirPath)
 {
-    return rmAbsPath(d->m_dirPath + "/" + dirPath);
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return DirMan_private::backendRmAbsPath(*b, d->m_dirPath + "/" + dirPath);
+
+    DirManPathBuilder path(d->m_dirPath);
+    path.push(dirPath);
+    return DirMan_private::rmAbsPath(path.c_str());
 }
 
-#ifndef PGE_FILES_PRESENT
-bool DirMan::beginWalking(const std::vector<std::string> &suffix_filters)
+bool DirMan::DirMan_private::buildMkTree(const std::vector<std::string> &paths, std::vector<DirManMkNode> &nodes)
 {
-    std::locale loc;
-    #ifdef _WIN32
-    std::wstring             &m_dirPath    = d->m_dirPathW;
-    #else
-    std::string              &m_dirPath    = d->m_dirPath;
-    #endif
-    DirMan_private::DirWalkerState &m_walkerState   = d->m_walkerState;
+    std::vector<std::vector<std::string> > split;
+    split.reserve(paths.size());
+    nodes.clear();
 
-    // Clear previous state
-    while(!m_walkerState.digStack.empty())
-        m_walkerState.digStack.pop();
+    for(const std::string &rawPath : paths)
+    {
+        std::string path = DirMan::cleanPath(rawPath);
+        // Paths must stay inside the base directory
+        if(path == ".." || path.compare(0, 3, "../") == 0)
+            return false;
 
-    // Initialize suffix filters
-    m_walkerState.suffix_filters.clear();
-    m_walkerState.suffix_filters.reserve(suffix_filters.size());
-    for(const std::string &filter : suffix_filters)
+        std::vector<std::string> parts;
+        size_t begin = 0;
+
+        while(begin <= path.size())
+        {
+            size_t slash = path.find('/', begin);
+            if(slash == std::string::npos)
+                slash = path.size();
+
+            if(slash > begin && path.compare(begin, slash - begin, ".") != 0)
+                parts.push_back(path.substr(begin, slash - begin));
+
+            begin = slash + 1;
+        }
+
+        if(!parts.empty())
+            split.push_back(std::move(parts));
+    }
+
+    // Sorting by components keeps every sub-tree together, unlike sorting of whole paths
+    std::sort(split.begin(), split.end());
+
+    // Nodes of the previous path
+    std::vector<size_t> branch;
+
+    for(std::vector<std::string> &parts : split)
     {
-        std::string f;
-        f.reserve(filter.size());
-        for(const char &c : filter)
-            f.push_back(std::tolower(c, loc));
-        m_walkerState.suffix_filters.push_back(f);
+        size_t common = 0;
+        while(common < branch.size() && common < parts.size() && nodes[branch[common]].name == parts[common])
+            common++;
+
+        while(branch.size() > common)
+        {
+            nodes[branch.back()].end = nodes.size();
+            branch.pop_back();
+        }
+
+        for(size_t i = common; i < parts.size(); ++i)
+        {
+            DirManMkNode n;
+            n.name = std::move(parts[i]);
+            n.depth = i + 1;
+            nodes.push_back(std::move(n));
+            branch.push_back(nodes.size() - 1);
+        }
     }
 
-    // Push initial path
-    m_walkerState.digStack.push(m_dirPath);
+    for(size_t i : branch)
+        nodes[i].end = nodes.size();
+
     return true;
 }
 
-bool DirMan::fetchListFromWalker(std::string &curPath, std::vector<std::string> &list)
+bool DirMan::mkpathMany(const std::vector<std::string> &paths, unsigned threads)
 {
-    return d->fetchListFromWalker(curPath, list);
+    std::vector<DirManMkNode> nodes;
+    if(!DirMan_private::buildMkTree(paths, nodes))
+        return false;
+
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    bool native = DirMan_private::isNative(*b);
+    std::string base = d->m_dirPath;
+    auto mkTree = [&](const std::string &at, size_t begin, size_t end) -> bool
+    {
+        if(!native)
+            return DirMan_private::backendMkTree(*b, at, nodes, begin, end);
+        return DirMan_private::mkTree(at.c_str(), nodes, begin, end);
+    };
+
+    if(!native)
+    {
+        if(!DirMan_private::backendExists(*b, base) && !DirMan_private::backendMkAbsPath(*b, base))
+            return false;
+    }
+    else if(!DirMan_private::exists(base.c_str()) && !DirMan_private::mkAbsPath(base.c_str()))
+        return false;
+
+    if(nodes.empty())
+        return true;
+
+    size_t begin = 0, end = nodes.size();
+
+    // Create the chain of single parents first, its children are independent sub-trees
+    while(threads != 1 && end - begin > 1 && nodes[begin].end == end)
+    {
+        if(!mkTree(base, begin, begin + 1))
+            return false;
+        base += '/' + nodes[begin].name;
+        begin++;
+    }
+
+    size_t subTrees = 0;
+    for(size_t i = begin; i < end; i = nodes[i].end)
+        subTrees++;
+
+    if(threads == 1 || subTrees < 2)
+        return mkTree(base, begin, end);
+
+    DirManWorkQueue<size_t> queue;
+    std::atomic<bool> ok(true);
+
+    for(size_t i = begin; i < end; i = nodes[i].end)
+        queue.push(size_t(i));
+
+    DirManWorkQueue<size_t>::run(threads, [&]()
+    {
+        size_t i;
+        while(queue.pop(i))
+        {
+            if(!mkTree(base, i, nodes[i].end))
+                ok = false;
+            queue.done();
+        }
+    });
+
+    return ok;
+}
+
+bool DirMan::mkAbsDir(const std::string &dirPath)
+{
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return b->mkdir(dirPath);
+
+    return DirMan_private::mkAbsDir(dirPath.c_str());
+}
+
+bool DirMan::rmAbsDir(const std::string &dirPath)
+{
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return b->rmdir(dirPath);
+
+    return DirMan_private::rmAbsDir(dirPath.c_str());
+}
+
+bool DirMan::mkAbsPath(const std::string &dirPath)
+{
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return DirMan_private::backendMkAbsPath(*b, dirPath);
+
+    return DirMan_private::mkAbsPath(dirPath.c_str());
+}
+
+bool DirMan::rmAbsPath(const std::string &dirPath)
+{
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return DirMan_private::backendRmAbsPath(*b, dirPath);
+
+    return DirMan_private::rmAbsPath(dirPath.c_str());
+}
+
+bool DirMan::diskUsage(DiskUsage &out, unsigned threads)
+{
+    std::shared_ptr<DirManBackend> b = DirMan_private::backend();
+    if(!DirMan_private::isNative(*b))
+        return d->backendDiskUsage(*b, out, threads);
+
+    return d->diskUsage(out, threads);
+}
+
+void DirMan::DirMan_private::buildDiskUsage(std::deque<DiskUsageNode> &nodes, DiskUsage &out)
+{
+    // Sub-directories always have larger indices than their parents: sum totals from the bottom
+    std::vector<DiskUsage> tree(nodes.size());
+    for(size_t i = nodes.size(); i-- > 0;)
+    {
+        DiskUsageNode &n = nodes[i];
+        DiskUsage &u = tree[i];
+        u.name = std::move(n.name);
+        u.bytes += n.bytes;
+        u.apparentBytes += n.apparentBytes;
+        u.files += n.files;
+        std::sort(u.children.begin(), u.children.end(),
+                  [](const DiskUsage &a, const DiskUsage &b) { return a.name < b.name; });
+
+        if(i == 0)
+            break;
+
+        DiskUsage &p = tree[n.parent];
+        p.bytes += u.bytes;
+        p.apparentBytes += u.apparentBytes;
+        p.files += u.files;
+        p.dirs += u.dirs + 1;
+        p.children.push_back(std::move(u));
+    }
+
+    out = std::move(tree[0]);
+}
+
+void DirMan::findDuplicates(const std::vector<FileFingerprint> &files, std::vector<std::vector<size_t>> &groups)
+{
+    groups.clear();
+
+    std::vector<size_t> order(files.size());
+    for(size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    std::sort(order.begin(), order.end(), [&files](size_t a, size_t b)
+    {
+        if(files[a].size != files[b].size)
+            return files[a].size < files[b].size;
+        if(files[a].hash != files[b].hash)
+            return files[a].hash < files[b].hash;
+        return a < b;
+    });
+
+    for(size_t i = 0; i < order.size();)
+    {
+        const FileFingerprint &f = files[order[i]];
+        size_t j = i + 1;
+
+        while(j < order.size() && files[order[j]].size == f.size && files[order[j]].hash == f.hash)
+            j++;
+
+        if(j - i > 1)
+            groups.emplace_back(order.begin() + i, order.begin() + j);
+
+        i = j;
+    }
+}
+
+void DirMan::DirMan_private::setSnapshotDirInfo(TreeSnapshot::Dir &dir, const EntryInfo &info)
+{
+    dir.inode = info.inode;
+    dir.mtime = info.mtime;
+    dir.ctime = info.ctime;
+}
+
+//! The listing of the directory in the previous snapshot is still valid
+static bool isSnapshotDirUnchanged(const DirMan::TreeSnapshot::Dir &dir, const DirMan::TreeSnapshot::Dir *prev, int64_t taken)
+{
+    if(!prev || taken == 0 || dir.mtime == 0)
+        return false;
+
+    if(dir.inode != prev->inode || dir.mtime != prev->mtime || dir.ctime != prev->ctime)
+        return false;
+
+    // A change made right after the directory has been read may keep the same time stamp.
+    // Times in whole seconds come from coarse file systems (FAT stores even seconds only).
+    const int64_t margin = dir.mtime % 1000000000 == 0 ? 2000000000LL : 50000000LL;
+    const int64_t changed = dir.ctime > dir.mtime ? dir.ctime : dir.mtime;
+
+    return changed < taken - margin;
+}
+
+bool DirMan::DirMan_private::snapshotDir(const std::string &path, TreeSnapshot::Dir &dir, const TreeSnapshot::Dir *prev, SnapshotScan &scan)
+{
+    DirManBackend *b = scan.backend;
+    EntryInfo info;
+
+    if(isSnapshotDirUnchanged(dir, prev, scan.previousTaken))
+    {
+        dir.files = prev->files;
+
+        if(scan.statFiles)
+        {
+            for(DirMan::TreeSnapshot::File &f : dir.files)
+            {
+                if(statPath(*b, path + "/" + f.name, info) && info.isFile)
+                {
+                    f.size = info.size;
+                    f.mtime = info.mtime;
+                }
+            }
+        }
+
+        // Changes deeper in the tree don't touch this directory: check every sub-directory
+        dir.dirs.resize(prev->dirs.size());
+        for(size_t i = 0; i < prev->dirs.size(); ++i)
+        {
+            DirMan::TreeSnapshot::Dir &sub = dir.dirs[i];
+            sub.name = prev->dirs[i].name;
+            const std::string subPath = path + "/" + sub.name;
+            if(statPath(*b, subPath, info) && info.isDir)
+            {
+                setSnapshotDirInfo(sub, info);
+                snapshotDir(subPath, sub, &prev->dirs[i], scan); // Unreadable directories stay empty
+            }
+        }
+    }
+    else
+    {
+        std::vector<EntryInfo> &buffer = scan.buffer;
+        if(!listDirectory(*b, path, buffer))
+            return false;
+
+        scan.readDirs++;
+
+        std::vector<EntryInfo> subDirs;
+
+        for(EntryInfo &e : buffer)
+        {
+            if(e.isDir)
+                subDirs.push_back(std::move(e));
+            else if(e.isFile)
+            {
+                dir.files.emplace_back();
+                DirMan::TreeSnapshot::File &f = dir.files.back();
+                f.name = std::move(e.name);
+                f.size = e.size;
+                f.mtime = e.mtime;
+            }
+        }
+
+        std::sort(subDirs.begin(), subDirs.end(), [](const EntryInfo &a, const EntryInfo &b)
+        {
+            return a.name < b.name;
+        });
+        std::sort(dir.files.begin(), dir.files.end(),
+                  [](const DirMan::TreeSnapshot::File &a, const DirMan::TreeSnapshot::File &b)
+        {
+            return a.name < b.name;
+        });
+
+        dir.dirs.resize(subDirs.size());
+        for(size_t i = 0; i < subDirs.size(); ++i)
+        {
+            DirMan::TreeSnapshot::Dir &sub = dir.dirs[i];
+            sub.name = std::move(subDirs[i].name);
+            setSnapshotDirInfo(sub, subDirs[i]);
+
+            // Both lists are sorted by name
+            const DirMan::TreeSnapshot::Dir *prevSub = nullptr;
+            if(prev)
+            {
+                auto it = std::lower_bound(prev->dirs.begin(), prev->dirs.end(), sub.name,
+                                           [](const DirMan::TreeSnapshot::Dir &d, const std::string &name)
+                {
+                    return d.name < name;
+                });
+                if(it != prev->dirs.end() && it->name == sub.name)
+                    prevSub = &*it;
+            }
+
+            snapshotDir(path + "/" + sub.name, sub, prevSub, scan); // Unreadable directories stay empty
+        }
+    }
+
+    DirManHash64 hash;
+    for(const DirMan::TreeSnapshot::File &f : dir.files)
+    {
+        hash.update("f", 1);
+        hash.update(f.name.c_str(), f.name.size() + 1);
+        hash.update(f.size);
+        hash.update(static_cast<uint64_t>(f.mtime));
+    }
+
+    for(const DirMan::TreeSnapshot::Dir &sub : dir.dirs)
+    {
+        hash.update("d", 1);
+        hash.update(sub.name.c_str(), sub.name.size() + 1);
+        hash.update(sub.digest);
+    }
+
+    dir.digest = hash.digest();
+
+    return true;
+}
+
+bool DirMan::DirMan_private::snapshotTree(const std::string &path, TreeSnapshot &out, const TreeSnapshot::Dir *prev, SnapshotScan &scan)
+{
+    out = TreeSnapshot();
+    out.taken = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Held till the end of the scan
+    std::shared_ptr<DirManBackend> b = backend();
+    scan.backend = b.get();
+
+    EntryInfo info;
+    if(!statPath(*b, path, info) || !info.isDir)
+        return false;
+
+    setSnapshotDirInfo(out.root, info);
+
+    return snapshotDir(path, out.root, prev, scan);
+}
+
+bool DirMan::takeSnapshot(TreeSnapshot &out)
+{
+    DirMan_private::SnapshotScan scan;
+    return DirMan_private::snapshotTree(d->m_dirPath, out, nullptr, scan);
+}
+
+bool DirMan::rescanSnapshot(const TreeSnapshot &previous, TreeSnapshot &out, std::vector<TreeChange> &changes,
+                            bool statFiles, size_t *readDirs)
+{
+    DirMan_private::SnapshotScan scan;
+    scan.previousTaken = previous.taken;
+    scan.statFiles = statFiles;
+
+    changes.clear();
+    bool ok = DirMan_private::snapshotTree(d->m_dirPath, out, &previous.root, scan);
+    if(readDirs)
+        *readDirs = scan.readDirs;
+
+    if(ok)
+        diffSnapshots(previous, out, changes);
+
+    return ok;
+}
+
+static void reportSnapshotDir(const DirMan::TreeSnapshot::Dir &dir, const std::string &path,
+                              DirMan::TreeChange::Type type, std::vector<DirMan::TreeChange> &changes)
+{
+    DirMan::TreeChange c;
+    c.type = type;
+    c.path = path;
+    c.isDir = true;
+    changes.push_back(c);
+
+    for(const DirMan::TreeSnapshot::File &f : dir.files)
+    {
+        c.path = path + "/" + f.name;
+        c.isDir = false;
+        changes.push_back(c);
+    }
+
+    for(const DirMan::TreeSnapshot::Dir &sub : dir.dirs)
+        reportSnapshotDir(sub, path + "/" + sub.name, type, changes);
+}
+
+static void diffSnapshotDirs(const DirMan::TreeSnapshot::Dir &from, const DirMan::TreeSnapshot::Dir &to,
+                             const std::string &path, std::vector<DirMan::TreeChange> &changes)
+{
+    typedef DirMan::TreeChange TC;
+    const std::string prefix = path.empty() ? path : path + "/";
+    TC c;
+
+    // Both lists are sorted by name: merge them
+    size_t i = 0, j = 0;
+    while(i < from.files.size() || j < to.files.size())
+    {
+        c.isDir = false;
+        if(j >= to.files.size() || (i < from.files.size() && from.files[i].name < to.files[j].name))
+        {
+            c.type = TC::REMOVED;
+            c.path = prefix + from.files[i++].name;
+            changes.push_back(c);
+        }
+        else if(i >= from.files.size() || to.files[j].name < from.files[i].name)
+        {
+            c.type = TC::ADDED;
+            c.path = prefix + to.files[j++].name;
+            changes.push_back(c);
+        }
+        else
+        {
+            const DirMan::TreeSnapshot::File &a = from.files[i++], &b = to.files[j++];
+            if(a.size != b.size || a.mtime != b.mtime)
+            {
+                c.type = TC::MODIFIED;
+                c.path = prefix + b.name;
+                changes.push_back(c);
+            }
+        }
+    }
+
+    i = 0;
+    j = 0;
+    while(i < from.dirs.size() || j < to.dirs.size())
+    {
+        if(j >= to.dirs.size() || (i < from.dirs.size() && from.dirs[i].name < to.dirs[j].name))
+        {
+            reportSnapshotDir(from.dirs[i], prefix + from.dirs[i].name, TC::REMOVED, changes);
+            i++;
+        }
+        else if(i >= from.dirs.size() || to.dirs[j].name < from.dirs[i].name)
+        {
+            reportSnapshotDir(to.dirs[j], prefix + to.dirs[j].name, TC::ADDED, changes);
+            j++;
+        }
+        else
+        {
+            const DirMan::TreeSnapshot::Dir &a = from.dirs[i++], &b = to.dirs[j++];
+            if(a.digest != b.digest)
+                diffSnapshotDirs(a, b, prefix + b.name, changes);
+        }
+    }
+}
+
+void DirMan::diffSnapshots(const TreeSnapshot &from, const TreeSnapshot &to, std::vector<TreeChange> &changes)
+{
+    changes.clear();
+
+    if(from.root.digest == to.root.digest)
+        return;
+
+    diffSnapshotDirs(from.root, to.root, std::string(), changes);
+}
+
+std::shared_ptr<const DirMan::DirMan_private::IgnoreRules>
+DirMan::DirMan_private::IgnoreRules::parse(FILE *f, size_t depth, const std::shared_ptr<const IgnoreRules> &parent)
+{
+    std::string text;
+    char buf[1024];
+    size_t got;
+
+    while((got = fread(buf, 1, sizeof(buf), f)) > 0)
+        text.append(buf, got);
+
+    return parse(text, depth, parent);
+}
+
+std::shared_ptr<const DirMan::DirMan_private::IgnoreRules>
+DirMan::DirMan_private::IgnoreRules::parse(const std::string &text, size_t depth, const std::shared_ptr<const IgnoreRules> &parent)
+{
+    std::shared_ptr<IgnoreRules> out(new IgnoreRules);
+    out->depth = depth;
+    out->parent = parent;
+
+    size_t pos = 0;
+    while(pos < text.size())
+    {
+        size_t end = text.find('\n', pos);
+        if(end == std::string::npos)
+            end = text.size();
+
+        std::string l = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        while(!l.empty() && (l.back() == '\n' || l.back() == '\r' || l.back() == ' ' || l.back() == '\t'))
+            l.pop_back();
+
+        if(l.empty() || l[0] == '#')
+            continue;
+
+        Rule r;
+        if(l[0] == '!')
+        {
+            r.negate = true;
+            l.erase(0, 1);
+        }
+
+        if(!l.empty() && l[0] == '/')
+        {
+            r.anchored = true;
+            l.erase(0, 1);
+        }
+
+        if(!l.empty() && l.back() == '/')
+        {
+            r.dirOnly = true;
+            l.pop_back();
+        }
+
+        if(l.empty())
+            continue;
+
+        r.pattern = l;
+        out->rules.push_back(r);
+    }
+
+    if(out->rules.empty())
+        return parent;
+
+    return out;
+}
+
+bool DirMan::DirMan_private::IgnoreRules::isIgnored(const IgnoreRules *rules, const std::string &name, bool isDir, size_t depth)
+{
+    // The closest rule file wins, and inside of the file the last matching rule wins
+    for(; rules; rules = rules->parent.get())
+    {
+        for(auto r = rules->rules.rbegin(); r != rules->rules.rend(); ++r)
+        {
+            if(r->dirOnly && !isDir)
+                continue;
+
+            if(r->anchored && depth != rules->depth + 1)
+                continue;
+
+            if(matchGlob(name, r->pattern))
+                return !r->negate;
+        }
+    }
+
+    return false;
+}
+
+bool DirMan::DirMan_private::DirWalkerState::isPrunedDir(const std::string &parentPath,
+                                                         const std::string &name,
+                                                         const Entry &parent) const
+{
+    for(const std::string &n : options.pruneNames)
+    {
+        if(n == name)
+            return true;
+    }
+
+    for(const std::string &g : options.pruneGlobs)
+    {
+        if(matchGlob(name, g))
+            return true;
+    }
+
+    if(parent.rules && IgnoreRules::isIgnored(parent.rules.get(), name, true, parent.depth + 1))
+        return true;
+
+    if(options.pruneCallback && options.pruneCallback(parentPath, name))
+        return true;
+
+    return false;
+}
+
+void DirMan::DirMan_private::DirWalkerState::filterIgnoredFiles(std::vector<std::string> &list, const Entry &parent) const
+{
+    if(!parent.rules)
+        return;
+
+    size_t out = 0;
+    for(size_t i = 0; i < list.size(); ++i)
+    {
+        if(IgnoreRules::isIgnored(parent.rules.get(), list[i], false, parent.depth + 1))
+            continue;
+        if(out != i)
+            list[out] = std::move(list[i]);
+        out++;
+    }
+
+    list.resize(out);
+}
+
+void DirMan::DirMan_private::DirWalkerState::reset()
+{
+    digStack.clear();
+    paths.clear();
+    current = DirManPathTree::NONE;
+    ready.clear();
+    // A half of a split walk may still use the set
+    if(visited && visited.use_count() == 1)
+        visited->clear();
+    else
+        visited = std::make_shared<DirManVisitedSet>();
+    backend.reset();
+    rootDevice = 0;
+    skippedDevices.clear();
+    dirsFetched = 0;
+    entriesFetched = 0;
+    stopped = false;
+    rootLength = 0;
+}
+
+bool DirMan::DirMan_private::DirWalkerState::split(DirWalkerState &out)
+{
+    if(!canSplit())
+        return false;
+
+    out.reset();
+    out.suffix_filters = suffix_filters;
+    out.options = options;
+    // Both halves skip directories entered by each other
+    out.visited = visited;
+    out.backend = backend;
+    out.rootDevice = rootDevice;
+    out.skippedDevices = skippedDevices;
+    out.rootLength = rootLength;
+
+    // The oldest directories are the closest to the root, so they hold the largest sub-trees
+    size_t half = digStack.size() / 2;
+    std::unordered_map<uint32_t, uint32_t> copied;
+    std::vector<uint32_t> chain;
+
+    for(size_t i = 0; i < half; ++i)
+    {
+        Pending &p = digStack[i];
+
+        // Copy the missing part of the path, parents first
+        chain.clear();
+        uint32_t id = p.node;
+        for(; id != DirManPathTree::NONE && copied.find(id) == copied.end(); id = paths.parent(id))
+            chain.push_back(id);
+
+        uint32_t parent = id == DirManPathTree::NONE ? id : copied[id];
+        for(auto it = chain.rbegin(); it != chain.rend(); ++it)
+        {
+            PathString name = paths.name(*it);
+            uint32_t node = out.paths.add(parent, name.data(), name.size());
+            // The reference of the caller is kept by the pending entry only
+            if(it != chain.rbegin())
+                out.paths.release(parent);
+            copied[*it] = node;
+            parent = node;
+        }
+
+        if(chain.empty())
+            out.paths.retain(parent);
+
+        out.digStack.push_back(p);
+        out.digStack.back().node = parent;
+        paths.release(p.node);
+    }
+
+    digStack.erase(digStack.begin(), digStack.begin() + half);
+
+    // Share the remaining budget, limits are kept and counters are advanced instead
+    if(options.maxDirectories > 0)
+    {
+        size_t share = (options.maxDirectories - dirsFetched) / 2;
+        out.dirsFetched = options.maxDirectories - share;
+        dirsFetched += share;
+    }
+
+    if(options.maxEntries > 0)
+    {
+        size_t share = (options.maxEntries - entriesFetched) / 2;
+        out.entriesFetched = options.maxEntries - share;
+        entriesFetched += share;
+    }
+
+    return true;
+}
+
+/*
+ * Walker checkpoints: unsigned numbers are stored as LEB128 varints, strings as the length
+ * and bytes. The XXH64 hash of the content is appended to catch damaged files.
+ */
+static const char s_checkpointMagic[4] = {'D', 'M', 'W', 'K'};
+static const uint64_t s_checkpointVersion = 1;
+
+struct CheckpointWriter
+{
+    std::string &out;
+
+    void u(uint64_t v)
+    {
+        do
+        {
+            unsigned char b = v & 0x7F;
+            v >>= 7;
+            out.push_back(static_cast<char>(v ? (b | 0x80) : b));
+        } while(v);
+    }
+
+    void s(const std::string &str)
+    {
+        u(str.size());
+        out.append(str);
+    }
+
+    void list(const std::vector<std::string> &l)
+    {
+        u(l.size());
+        for(const std::string &str : l)
+            s(str);
+    }
+};
+
+struct CheckpointReader
+{
+    const std::string &in;
+    size_t pos;
+    size_t end;
+    bool ok;
+
+    uint64_t u()
+    {
+        uint64_t v = 0;
+        for(unsigned shift = 0; ok; shift += 7)
+        {
+            if(pos >= end || shift > 63)
+            {
+                ok = false;
+                break;
+            }
+            unsigned char b = static_cast<unsigned char>(in[pos++]);
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if((b & 0x80) == 0)
+                return v;
+        }
+        return 0;
+    }
+
+    //! Count of items which need at least one byte each, protects from huge allocations
+    size_t count()
+    {
+        uint64_t n = u();
+        if(n > end - pos)
+            ok = false;
+        return ok ? static_cast<size_t>(n) : 0;
+    }
+
+    void s(std::string &str)
+    {
+        size_t n = count();
+        str.assign(ok ? in.data() + pos : "", n);
+        pos += n;
+    }
+
+    void list(std::vector<std::string> &l)
+    {
+        l.resize(count());
+        for(std::string &str : l)
+            s(str);
+    }
+};
+
+bool DirMan::DirMan_private::DirWalkerState::save(std::string &out, const std::string &root, const PathString &rootPath) const
+{
+    out.clear();
+    out.append(s_checkpointMagic, sizeof(s_checkpointMagic));
+
+    CheckpointWriter w = {out};
+    w.u(s_checkpointVersion);
+    w.s(root);
+
+    w.u(static_cast<uint64_t>(options.order));
+    w.u(static_cast<uint64_t>(options.maxDepth + 1));
+    w.u(options.maxEntries);
+    w.u(options.maxDirectories);
+    w.u((options.followSymlinks ? 1 : 0) | (options.oneFileSystem ? 2 : 0) | (stopped ? 4 : 0));
+    w.list(options.skipFileSystems);
+    w.list(options.pruneNames);
+    w.list(options.pruneGlobs);
+    w.s(options.ignoreFileName);
+    w.u(options.prefetchDirectories);
+    w.u(options.shardCount);
+    w.u(options.shardIndex);
+    w.u(options.shardDepth);
+    w.list(suffix_filters);
+
+    w.u(dirsFetched);
+    w.u(entriesFetched);
+    w.u(rootDevice);
+
+    // Rule sets are shared by many directories: save each one once, parents go first
+    std::unordered_map<const IgnoreRules *, size_t> ruleIds;
+    std::vector<const IgnoreRules *> ruleList;
+    std::vector<const IgnoreRules *> chain;
+    for(const Pending &e : digStack)
+    {
+        chain.clear();
+        for(const IgnoreRules *r = e.rules.get(); r && ruleIds.find(r) == ruleIds.end(); r = r->parent.get())
+            chain.push_back(r);
+
+        for(auto it = chain.rbegin(); it != chain.rend(); ++it)
+        {
+            ruleIds[*it] = ruleList.size();
+            ruleList.push_back(*it);
+        }
+    }
+
+    w.u(ruleList.size());
+    for(const IgnoreRules *r : ruleList)
+    {
+        w.u(r->parent ? ruleIds[r->parent.get()] + 1 : 0);
+        w.u(r->depth);
+        w.u(r->rules.size());
+        for(const IgnoreRules::Rule &rule : r->rules)
+        {
+            w.s(rule.pattern);
+            w.u((rule.negate ? 1 : 0) | (rule.dirOnly ? 2 : 0) | (rule.anchored ? 4 : 0));
+        }
+    }
+
+    if(!visited)
+        w.u(0); // The walk has never been started
+    else
+    {
+        visited->read([&w](const DirManInodeSet &set)
+        {
+            w.u(set.size());
+            set.forEach([&w](uint64_t dev, uint64_t ino)
+            {
+                w.u(dev);
+                w.u(ino);
+            });
+        });
+    }
+
+    // Paths of pending directories as a tree of names: the root is 0, parents go first
+    std::unordered_map<uint32_t, size_t> nodeIds;
+    std::vector<uint32_t> nodeList, nodeChain;
+    for(const Pending &e : digStack)
+    {
+        nodeChain.clear();
+        uint32_t id = e.node;
+        for(; paths.parent(id) != DirManPathTree::NONE && nodeIds.find(id) == nodeIds.end(); id = paths.parent(id))
+            nodeChain.push_back(id);
+
+        if(paths.parent(id) == DirManPathTree::NONE && paths.name(id) != rootPath)
+            return false; // The root has been changed during the walk
+
+        for(auto it = nodeChain.rbegin(); it != nodeChain.rend(); ++it)
+        {
+            nodeIds[*it] = nodeList.size() + 1;
+            nodeList.push_back(*it);
+        }
+    }
+
+    w.u(nodeList.size());
+    for(uint32_t id : nodeList)
+    {
+        uint32_t parent = paths.parent(id);
+        w.u(paths.parent(parent) == DirManPathTree::NONE ? 0 : nodeIds[parent]);
+        w.s(fromPathString(paths.name(id)));
+    }
+
+    w.u(digStack.size());
+    for(const Pending &e : digStack)
+    {
+        w.u(paths.parent(e.node) == DirManPathTree::NONE ? 0 : nodeIds[e.node]);
+        w.u(e.depth);
+        w.u(e.device);
+        w.u(e.rules ? ruleIds[e.rules.get()] + 1 : 0);
+    }
+
+    // Directories read ahead but not returned yet
+    w.u(ready.size());
+    for(const ReadyDir &rd : ready)
+    {
+        w.s(rd.path);
+        w.list(rd.files);
+    }
+
+    DirManHash64 hash;
+    hash.update(out.data(), out.size());
+    uint64_t digest = hash.digest();
+    for(int i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>((digest >> (i * 8)) & 0xFF));
+
+    return true;
+}
+
+bool DirMan::DirMan_private::DirWalkerState::load(const std::string &in, std::string &root)
+{
+    reset();
+
+    if(in.size() < sizeof(s_checkpointMagic) + 8 ||
+       in.compare(0, sizeof(s_checkpointMagic), s_checkpointMagic, sizeof(s_checkpointMagic)) != 0)
+        return false;
+
+    const size_t end = in.size() - 8;
+    DirManHash64 hash;
+    hash.update(in.data(), end);
+    uint64_t digest = 0;
+    for(int i = 0; i < 8; ++i)
+        digest |= static_cast<uint64_t>(static_cast<unsigned char>(in[end + i])) << (i * 8);
+    if(digest != hash.digest())
+        return false;
+
+    CheckpointReader r = {in, sizeof(s_checkpointMagic), end, true};
+    uint64_t version = r.u();
+    if(version != s_checkpointVersion)
+        return false;
+
+    r.s(root);
+
+    options = WalkerOptions();
+    options.order = r.u() == WalkerOptions::BREADTH_FIRST ? WalkerOptions::BREADTH_FIRST : WalkerOptions::DEPTH_FIRST;
+    options.maxDepth = static_cast<int>(r.u()) - 1;
+    options.maxEntries = static_cast<size_t>(r.u());
+    options.maxDirectories = static_cast<size_t>(r.u());
+    uint64_t flags = r.u();
+    options.followSymlinks = (flags & 1) != 0;
+    options.oneFileSystem = (flags & 2) != 0;
+    stopped = (flags & 4) != 0;
+    r.list(options.skipFileSystems);
+    r.list(options.pruneNames);
+    r.list(options.pruneGlobs);
+    r.s(options.ignoreFileName);
+    options.prefetchDirectories = static_cast<size_t>(r.u());
+    options.shardCount = static_cast<size_t>(r.u());
+    options.shardIndex = static_cast<size_t>(r.u());
+    options.shardDepth = static_cast<size_t>(r.u());
+    r.list(suffix_filters);
+
+    dirsFetched = static_cast<size_t>(r.u());
+    entriesFetched = static_cast<size_t>(r.u());
+    rootDevice = r.u();
+
+    std::vector<std::shared_ptr<const IgnoreRules> > ruleList(r.count());
+    for(size_t i = 0; i < ruleList.size() && r.ok; ++i)
+    {
+        std::shared_ptr<IgnoreRules> rules = std::make_shared<IgnoreRules>();
+        uint64_t parent = r.u();
+        if(parent > i)
+            return false; // Parents are saved first
+        if(parent > 0)
+            rules->parent = ruleList[parent - 1];
+        rules->depth = static_cast<size_t>(r.u());
+        rules->rules.resize(r.count());
+        for(IgnoreRules::Rule &rule : rules->rules)
+        {
+            r.s(rule.pattern);
+            uint64_t ruleFlags = r.u();
+            rule.negate = (ruleFlags & 1) != 0;
+            rule.dirOnly = (ruleFlags & 2) != 0;
+            rule.anchored = (ruleFlags & 4) != 0;
+        }
+        ruleList[i] = std::move(rules);
+    }
+
+    size_t visitedCount = r.count();
+    for(size_t i = 0; i < visitedCount && r.ok; ++i)
+    {
+        uint64_t dev = r.u();
+        visited->insert(dev, r.u());
+    }
+
+    const PathString rootPath = toPathString(root);
+    rootLength = root.size();
+    std::vector<uint32_t> nodes(1, paths.add(DirManPathTree::NONE, rootPath.data(), rootPath.size()));
+    std::string name;
+
+    nodes.resize(r.count() + 1);
+    for(size_t i = 1; i < nodes.size() && r.ok; ++i)
+    {
+        uint64_t parent = r.u();
+        if(parent >= i)
+            return false; // Parents are saved first
+        r.s(name);
+        PathString n = toPathString(name);
+        nodes[i] = paths.add(nodes[parent], n.data(), n.size());
+    }
+
+    size_t entries = r.count();
+    for(size_t i = 0; i < entries && r.ok; ++i)
+    {
+        Pending e;
+        uint64_t node = r.u();
+        if(node >= nodes.size())
+            return false;
+        e.node = nodes[node];
+        paths.retain(e.node);
+        e.depth = static_cast<uint32_t>(r.u());
+        e.device = r.u();
+        uint64_t rules = r.u();
+        if(rules > ruleList.size())
+            return false;
+        if(rules > 0)
+            e.rules = ruleList[rules - 1];
+        digStack.push_back(std::move(e));
+    }
+
+    // Only nodes of pending directories and their parents are kept
+    for(uint32_t node : nodes)
+        paths.release(node);
+
+    ready.resize(r.count());
+    for(ReadyDir &rd : ready)
+    {
+        r.s(rd.path);
+        r.list(rd.files);
+    }
+
+    return r.ok && r.pos == end;
+}
+
+bool DirMan::DirMan_private::DirWalkerState::popDir(Entry &e)
+{
+    if(stopped || digStack.empty())
+    {
+        if(current != DirManPathTree::NONE)
+            paths.release(current);
+        current = DirManPathTree::NONE;
+        return false;
+    }
+
+    if(options.maxDirectories > 0 && dirsFetched >= options.maxDirectories)
+    {
+        clearPending();
+        stopped = true;
+        return false;
+    }
+
+    Pending &p = options.order == WalkerOptions::BREADTH_FIRST ? digStack.front() : digStack.back();
+    paths.path(p.node, e.path);
+    e.depth = p.depth;
+    e.device = p.device;
+    e.rules = std::move(p.rules);
+    e.node = p.node;
+
+    if(options.order == WalkerOptions::BREADTH_FIRST)
+        digStack.pop_front();
+    else
+        digStack.pop_back();
+
+    // The reference of the pending entry is kept until the next directory gets taken
+    if(current != DirManPathTree::NONE)
+        paths.release(current);
+    current = e.node;
+
+    dirsFetched++;
+    return true;
+}
+
+bool DirMan::DirMan_private::DirWalkerState::canEnter(size_t depth) const
+{
+    if(stopped)
+        return false;
+
+    if(options.maxDepth >= 0 && depth > static_cast<size_t>(options.maxDepth))
+        return false;
+
+    // Breadth-first walk will never reach directories beyond the budget: don't keep them
+    if(options.order == WalkerOptions::BREADTH_FIRST && options.maxDirectories > 0 &&
+       dirsFetched + digStack.size() >= options.maxDirectories)
+        return false;
+
+    return true;
+}
+
+void DirMan::DirMan_private::DirWalkerState::pushRoot(const PathString &path)
+{
+    Pending p;
+    p.node = paths.add(DirManPathTree::NONE, path.data(), path.size());
+    p.depth = 0;
+    p.device = 0;
+    digStack.push_back(std::move(p));
+#ifdef _WIN32
+    rootLength = fromPathString(path).size();
+#else
+    rootLength = path.size();
+#endif
+}
+
+void DirMan::DirMan_private::DirWalkerState::pushDir(const Entry &parent, const std::string &name, uint64_t device)
+{
+    Pending p;
+#ifdef _WIN32
+    PathString n = toPathString(name);
+    p.node = paths.add(parent.node, n.data(), n.size());
+#else
+    p.node = paths.add(parent.node, name.data(), name.size());
+#endif
+    p.depth = static_cast<uint32_t>(parent.depth + 1);
+    p.device = device;
+    p.rules = parent.rules;
+    digStack.push_back(std::move(p));
+}
+
+void DirMan::DirMan_private::DirWalkerState::clearPending()
+{
+    for(const Pending &p : digStack)
+        paths.release(p.node);
+    digStack.clear();
+}
+
+void DirMan::DirMan_private::DirWalkerState::applyEntriesBudget(std::vector<std::string> &list)
+{
+    if(options.maxEntries == 0)
+        return;
+
+    size_t left = options.maxEntries - entriesFetched;
+    if(list.size() >= left)
+    {
+        list.resize(left);
+        // Budget exhausted, stop the walk
+        clearPending();
+        stopped = true;
+    }
+
+    entriesFetched += list.size();
+}
+
+void DirMan::DirMan_private::DirWalkerState::enterRoot(Entry &e, uint64_t dev, uint64_t ino)
+{
+    e.device = dev;
+    rootDevice = dev;
+    if(options.followSymlinks)
+        visited->insert(dev, ino);
+}
+
+bool DirMan::DirMan_private::DirWalkerState::isSkippedFileSystem(uint64_t dev, const std::string &path)
+{
+    // Mount points are rare, a linear search over the met devices is enough
+    for(const std::pair<uint64_t, bool> &s : skippedDevices)
+    {
+        if(s.first == dev)
+            return s.second;
+    }
+
+    std::string type = DirMan::fileSystemType(path);
+    bool skip = !type.empty() &&
+                std::find(options.skipFileSystems.begin(), options.skipFileSystems.end(), type) != options.skipFileSystems.end();
+    skippedDevices.emplace_back(dev, skip);
+
+    return skip;
+}
+
+bool DirMan::DirMan_private::DirWalkerState::ownsShard(const std::string &dirPath, const std::string *name) const
+{
+    // Only directories down to the shard level get here, so building the relative path is cheap
+    std::string rel;
+    if(dirPath.size() > rootLength)
+        rel.assign(dirPath, rootLength + (dirPath[rootLength] == '/' ? 1 : 0), std::string::npos);
+
+    if(name)
+    {
+        if(!rel.empty())
+            rel.push_back('/');
+        rel.append(*name);
+    }
+
+    return DirMan::shardOf(rel, options.shardCount) == options.shardIndex;
+}
+
+void DirMan::DirMan_private::DirWalkerState::finishDir(Entry &e, const std::string &curPath, std::vector<std::string> &list)
+{
+    const size_t shardDepth = options.shardDepth > 0 ? options.shardDepth : 1;
+    const bool sharded = isSharded() && e.depth < shardDepth;
+
+    // Directories above the shard level are read by every shard, but only one returns their files
+    if(sharded && !ownsShard(curPath))
+        list.clear();
+
+    filterIgnoredFiles(list, e);
+    applyEntriesBudget(list);
+
+    bool prune = hasPruneRules() || e.rules;
+    for(SubDir &d : subDirs)
+    {
+        if(!canEnter(e.depth + 1))
+            break;
+
+        if(sharded && e.depth + 1 == shardDepth && !ownsShard(curPath, &d.name))
+            continue; // Sub-tree of another shard
+
+        if(options.followSymlinks)
+        {
+            // Plain sub-directories can't make a loop, only links and mount points are remembered
+            if((d.isLink || d.dev != e.device) && !visited->insert(d.dev, d.ino))
+                continue; // Already entered by another path
+        }
+        else if(d.isLink)
+            continue;
+
+        if(options.oneFileSystem && d.dev != rootDevice)
+            continue; // Mount point of another file system
+
+        if(!options.skipFileSystems.empty() && d.dev != e.device &&
+           isSkippedFileSystem(d.dev, curPath + "/" + d.name))
+            continue;
+
+        if(prune && isPrunedDir(curPath, d.name, e))
+            continue;
+
+        pushDir(e, d.name, d.dev);
+    }
+}
+
+size_t DirMan::shardOf(const std::string &relativePath, size_t shardCount)
+{
+    if(shardCount < 2)
+        return 0;
+
+    // FNV-1a: stable across platforms, runs and processes unlike std::hash
+    uint64_t hash = 14695981039346656037ULL;
+    for(const char &c : relativePath)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+
+    return static_cast<size_t>(hash % shardCount);
+}
+
+#ifndef PGE_FILES_PRESENT
+bool DirMan::beginWalking(const std::vector<std::string> &suffix_filters)
+{
+    return beginWalking(WalkerOptions(), suffix_filters);
+}
+
+bool DirMan::beginWalking(const WalkerOptions &options, const std::vector<std::string> &suffix_filters)
+{
+    std::locale loc;
+    #ifdef _WIN32
+    std::wstring             &m_dirPath    = d->m_dirPathW;
+    #else
+    std::string              &m_dirPath    = d->m_dirPath;
+    #endif
+    DirMan_private::DirWalkerState &m_walkerState   = d->m_walkerState;
+
+    // Clear previous state
+    d->stopPrefetch();
+    m_walkerState.reset();
+
+    // Initialize suffix filters
+    m_walkerState.suffix_filters.clear();
+    m_walkerState.suffix_filters.reserve(suffix_filters.size());
+    for(const std::string &filter : suffix_filters)
+    {
+        std::string f;
+        f.reserve(filter.size());
+        for(const char &c : filter)
+            f.push_back(std::tolower(c, loc));
+        m_walkerState.suffix_filters.push_back(f);
+    }
+
+    m_walkerState.options = options;
+    m_walkerState.backend = DirMan_private::backend();
+
+    // Push initial path
+    m_walkerState.pushRoot(m_dirPath);
+    d->startPrefetch();
+    return true;
+}
+
+bool DirMan::fetchListFromWalker(std::string &curPath, std::vector<std::string> &list)
+{
+    return d->walkerFetch(curPath, list);
+}
+
+size_t DirMan::fetchBatchFromWalker(std::vector<WalkerResult> &results, size_t maxEntries, size_t maxBytes)
+{
+    DirMan_private::WalkerBatch batch;
+    batch.results = &results;
+    batch.maxEntries = maxEntries;
+    batch.maxBytes = maxBytes;
+    d->walkerFetchBatch(batch);
+    return batch.count;
+}
+
+bool DirMan::DirMan_private::readNextDir(std::string &curPath, std::vector<std::string> &list)
+{
+    // No backend until the walk is started: there is nothing to read anyway
+    DirManBackend *b = m_walkerState.backend.get();
+    if(b && !isNative(*b))
+        return backendFetchListFromWalker(*b, curPath, list);
+
+    return fetchListFromWalker(curPath, list);
+}
+
+bool DirMan::DirMan_private::walkerFetch(std::string &curPath, std::vector<std::string> &list)
+{
+#ifdef DIRMAN_HAS_STD_THREADS
+    if(m_prefetch)
+    {
+        WalkerPrefetch &p = *m_prefetch;
+        std::unique_lock<std::mutex> lock(p.queueMutex);
+        p.cond.wait(lock, [this, &p]{ return !m_walkerState.ready.empty() || p.done; });
+
+        if(m_walkerState.ready.empty())
+            return false;
+
+        DirWalkerState::ReadyDir &r = m_walkerState.ready.front();
+        curPath.swap(r.path);
+        list.swap(r.files);
+        m_walkerState.ready.pop_front();
+        p.cond.notify_all();
+
+        return true;
+    }
+#endif
+
+    if(!m_walkerState.ready.empty())
+    {
+        DirWalkerState::ReadyDir &r = m_walkerState.ready.front();
+        curPath.swap(r.path);
+        list.swap(r.files);
+        m_walkerState.ready.pop_front();
+        return true;
+    }
+
+    return readNextDir(curPath, list);
+}
+
+void DirMan::DirMan_private::walkerFetchBatch(WalkerBatch &batch)
+{
+    std::deque<WalkerResult> &ready = m_walkerState.ready;
+
+#ifdef DIRMAN_HAS_STD_THREADS
+    if(m_prefetch)
+    {
+        // Take everything read ahead so far, wait only when nothing is ready yet
+        WalkerPrefetch &p = *m_prefetch;
+        std::unique_lock<std::mutex> lock(p.queueMutex);
+        p.cond.wait(lock, [&ready, &p]{ return !ready.empty() || p.done; });
+
+        while(!ready.empty() && !batch.full())
+        {
+            WalkerResult &r = batch.next();
+            r.path.swap(ready.front().path);
+            r.files.swap(ready.front().files);
+            ready.pop_front();
+            batch.commit();
+        }
+
+        p.cond.notify_all();
+        return;
+    }
+#endif
+
+    while(!ready.empty() && !batch.full())
+    {
+        WalkerResult &r = batch.next();
+        r.path.swap(ready.front().path);
+        r.files.swap(ready.front().files);
+        ready.pop_front();
+        batch.commit();
+    }
+
+    if(batch.full())
+        return;
+
+    DirManBackend *b = m_walkerState.backend.get();
+    if(b && !isNative(*b))
+        backendFetchBatchFromWalker(*b, batch);
+    else
+        fetchBatchFromWalker(batch);
+}
+
+void DirMan::DirMan_private::startPrefetch()
+{
+#ifdef DIRMAN_HAS_STD_THREADS
+    if(m_walkerState.options.prefetchDirectories == 0)
+        return;
+
+    m_prefetch.reset(new WalkerPrefetch);
+    m_prefetch->limit = m_walkerState.options.prefetchDirectories;
+
+    m_prefetch->thread = std::thread([this]()
+    {
+        WalkerPrefetch &p = *m_prefetch;
+
+        while(true)
+        {
+            {
+                // Backpressure: don't read more than the limit ahead
+                std::unique_lock<std::mutex> lock(p.queueMutex);
+                p.cond.wait(lock, [this, &p]{ return p.quit || m_walkerState.ready.size() < p.limit; });
+                if(p.quit)
+                    break;
+            }
+
+            DirWalkerState::ReadyDir r;
+            std::lock_guard<std::mutex> state(p.stateMutex);
+            bool more = readNextDir(r.path, r.files);
+
+            std::lock_guard<std::mutex> lock(p.queueMutex);
+            if(!more)
+            {
+                p.done = true;
+                p.cond.notify_all();
+                break;
+            }
+
+            m_walkerState.ready.push_back(std::move(r));
+            p.cond.notify_all();
+        }
+    });
+#endif
+}
+
+void DirMan::DirMan_private::stopPrefetch()
+{
+#ifdef DIRMAN_HAS_STD_THREADS
+    if(!m_prefetch)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_prefetch->queueMutex);
+        m_prefetch->quit = true;
+        m_prefetch->cond.notify_all();
+    }
+
+    m_prefetch->thread.join();
+    // Directories read ahead stay in the queue and get returned first
+    m_prefetch.reset();
+#endif
+}
+
+bool DirMan::saveWalkerCheckpoint(std::string &checkpoint) const
+{
+#ifdef DIRMAN_HAS_STD_THREADS
+    // Take the state between two directories of the reading thread
+    std::unique_lock<std::mutex> state, queue;
+    if(d->m_prefetch)
+    {
+        state = std::unique_lock<std::mutex>(d->m_prefetch->stateMutex);
+        queue = std::unique_lock<std::mutex>(d->m_prefetch->queueMutex);
+    }
+#endif
+
+#ifdef _WIN32
+    return d->m_walkerState.save(checkpoint, d->m_dirPath, d->m_dirPathW);
+#else
+    return d->m_walkerState.save(checkpoint, d->m_dirPath, d->m_dirPath);
+#endif
+}
+
+bool DirMan::resumeWalking(const std::string &checkpoint,
+                           const std::function<bool(const std::string &, const std::string &)> &pruneCallback)
+{
+    std::string root;
+    d->stopPrefetch();
+    if(!d->m_walkerState.load(checkpoint, root))
+    {
+        d->m_walkerState.reset();
+        return false;
+    }
+
+    d->m_walkerState.options.pruneCallback = pruneCallback;
+    d->m_walkerState.backend = DirMan_private::backend();
+    d->m_dirPath = root;
+#ifdef _WIN32
+    d->m_dirPathW = DirMan_private::toPathString(root);
+#endif
+
+    d->startPrefetch();
+    return true;
+}
+
+bool DirMan::splitWalker(DirMan &other)
+{
+    if(&other == this)
+        return false;
+
+#ifdef DIRMAN_HAS_STD_THREADS
+    // Keep the reading thread away from pending directories
+    std::unique_lock<std::mutex> state;
+    if(d->m_prefetch)
+        state = std::unique_lock<std::mutex>(d->m_prefetch->stateMutex);
+#endif
+
+    // The walk of the other one is left running when there is nothing to share
+    if(!d->m_walkerState.canSplit())
+        return false;
+
+    other.d->stopPrefetch();
+    d->m_walkerState.split(other.d->m_walkerState);
+
+    other.d->m_dirPath = d->m_dirPath;
+#ifdef _WIN32
+    other.d->m_dirPathW = d->m_dirPathW;
+#endif
+
+    other.d->startPrefetch();
+    return true;
+}
+
+bool DirMan::fingerprintFiles(std::vector<FileFingerprint> &out,
+                              const std::vector<FileFingerprint> &previous,
+                              const std::vector<std::string> &suffix_filters,
+                              unsigned threads)
+{
+    return fingerprintFiles(out, WalkerOptions(), previous, suffix_filters, threads);
+}
+
+bool DirMan::fingerprintFiles(std::vector<FileFingerprint> &out,
+                              const WalkerOptions &options,
+                              const std::vector<FileFingerprint> &previous,
+                              const std::vector<std::string> &suffix_filters,
+                              unsigned threads)
+{
+    out.clear();
+
+    std::unordered_map<std::string, const FileFingerprint*> prevIndex;
+    prevIndex.reserve(previous.size());
+    for(const FileFingerprint &f : previous)
+        prevIndex[f.path] = &f;
+
+    // Separated walker to keep the state of this one untouched
+    DirMan walker(*this);
+    if(!walker.beginWalking(options, suffix_filters))
+        return false;
+
+    DirManWorkQueue<FileFingerprint> queue;
+    DirManMutex mutex;
+    bool producerTaken = false;
+    const unsigned workers = DirManWorkQueue<FileFingerprint>::threadCount(threads);
+
+    // The walk waits for hashing threads, so pending paths don't take the memory of the whole tree
+    queue.setLimit(workers * 64);
+    // The walk is in progress until the producer finishes
+    queue.acquire();
+
+    // Files are read from the backend of the walk
+    DirManBackend &b = *walker.d->m_walkerState.backend;
+    const bool native = DirMan_private::isNative(b);
+
+    auto hashFile = [&](FileFingerprint &fp, std::vector<unsigned char> &buffer)
+    {
+        auto found = prevIndex.find(fp.path);
+        const FileFingerprint *prev = found != prevIndex.end() ? found->second : nullptr;
+        bool ok = native ? DirMan_private::fingerprintFile(fp, prev, buffer) :
+                           DirMan_private::backendFingerprintFile(b, fp, prev);
+        if(ok)
+        {
+            DirManMutexLocker lock(mutex);
+            out.push_back(std::move(fp));
+        }
+    };
+
+    DirManWorkQueue<FileFingerprint>::run(workers, [&]()
+    {
+        bool produce = false;
+        {
+            DirManMutexLocker lock(mutex);
+            produce = !producerTaken;
+            producerTaken = true;
+        }
+
+        std::vector<unsigned char> buffer;
+        FileFingerprint fp;
+
+        // The first thread walks and queues files, then it joins others to hash them
+        if(produce)
+        {
+            std::string curPath;
+            std::vector<std::string> files;
+            while(walker.fetchListFromWalker(curPath, files))
+            {
+                for(const std::string &f : files)
+                {
+                    FileFingerprint job;
+                    job.path = curPath + "/" + f;
+                    // Nobody else would take jobs from a full queue
+                    if(workers == 1)
+                        hashFile(job, buffer);
+                    else
+                        queue.push(std::move(job));
+                }
+            }
+            queue.done();
+        }
+
+        while(queue.pop(fp))
+        {
+            hashFile(fp, buffer);
+            queue.done();
+        }
+    });
+
+    std::sort(out.begin(), out.end(), [](const FileFingerprint &a, const FileFingerprint &b)
+    {
+        return a.path < b.path;
+    });
+
+    return true;
+}
+
+bool DirMan::verifyShardCoverage(const WalkerOptions &options,
+                                 const std::vector<std::vector<std::string> > &shardFiles,
+                                 std::vector<std::string> &missing,
+                                 std::vector<std::string> &duplicated,
+                                 const std::vector<std::string> &suffix_filters)
+{
+    missing.clear();
+    duplicated.clear();
+
+    WalkerOptions fullWalk = options;
+    fullWalk.shardCount = 0;
+    fullWalk.shardIndex = 0;
+    fullWalk.prefetchDirectories = 0;
+
+    // Separated walker to keep the state of this one untouched
+    DirMan walker(*this);
+    if(!walker.beginWalking(fullWalk, suffix_filters))
+        return false;
+
+    std::vector<std::string> all, returned;
+    std::vector<WalkerResult> batch;
+    size_t got;
+
+    while((got = walker.fetchBatchFromWalker(batch, 4096)) > 0)
+    {
+        for(size_t r = 0; r < got; ++r)
+        {
+            for(const std::string &f : batch[r].files)
+                all.push_back(batch[r].path + "/" + f);
+        }
+    }
+
+    for(const std::vector<std::string> &shard : shardFiles)
+        returned.insert(returned.end(), shard.begin(), shard.end());
+
+    std::sort(all.begin(), all.end());
+    std::sort(returned.begin(), returned.end());
+
+    for(size_t i = 1; i < returned.size(); ++i)
+    {
+        if(returned[i] == returned[i - 1] && (duplicated.empty() || duplicated.back() != returned[i]))
+            duplicated.push_back(returned[i]);
+    }
+
+    std::set_difference(all.begin(), all.end(), returned.begin(), returned.end(), std::back_inserter(missing));
+
+    return missing.empty() && duplicated.empty();
+}
+
+bool DirMan::classifyFiles(std::vector<FileBucket> &buckets,
+                           const std::vector<FileGroup> &groups,
+                           bool collectPaths)
+{
+    return classifyFiles(buckets, groups, WalkerOptions(), collectPaths);
+}
+
+bool DirMan::classifyFiles(std::vector<FileBucket> &buckets,
+                           const std::vector<FileGroup> &groups,
+                           const WalkerOptions &options,
+                           bool collectPaths)
+{
+    std::locale loc;
+    const size_t groupsCount = groups.size();
+    std::vector<std::vector<std::string> > filters(groupsCount);
+
+    buckets.clear();
+    buckets.resize(groupsCount + 1);
+    for(size_t i = 0; i < groupsCount; ++i)
+    {
+        buckets[i].name = groups[i].name;
+        // Suffixes are compared in lower case, like beginWalking() does
+        for(const std::string &filter : groups[i].suffixFilters)
+        {
+            std::string f;
+            f.reserve(filter.size());
+            for(const char &c : filter)
+                f.push_back(std::tolower(c, loc));
+            filters[i].push_back(f);
+        }
+    }
+    buckets[groupsCount].name = "unclassified";
+
+    if(!exists())
+        return false;
+
+    // Separated walker to keep the state of this one untouched, it returns every file
+    DirMan walker(*this);
+    if(!walker.beginWalking(options))
+        return false;
+
+    auto addFile = [collectPaths](FileBucket &b, const std::string &dirPath, const std::string &name)
+    {
+        b.count++;
+        if(collectPaths)
+            b.files.push_back(dirPath + "/" + name);
+    };
+
+    std::vector<WalkerResult> batch;
+    size_t got;
+
+    while((got = walker.fetchBatchFromWalker(batch, 4096)) > 0)
+    {
+        for(size_t r = 0; r < got; ++r)
+        {
+            const WalkerResult &dir = batch[r];
+
+            for(const std::string &f : dir.files)
+            {
+                bool matched = false;
+
+                for(size_t i = 0; i < groupsCount; ++i)
+                {
+                    if(!matchSuffixFilters(f.data(), f.size(), filters[i]))
+                        continue;
+
+                    addFile(buckets[i], dir.path, f);
+                    matched = true;
+                }
+
+                if(!matched)
+                    addFile(buckets[groupsCount], dir.path, f);
+            }
+        }
+    }
+
+    return true;
 }
 #endif // #ifndef PGE_FILES_PRESENT
@@ -0,0 +1,372 @@
+/*
+ * DirMan - A small crossplatform class to manage directories
+ *
+ * Copyright (c) 2017-2026 Vitaliy Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include "../include/DirManager/dirman.h"
+#include "../include/DirManager/dirman_async.h"
+#include "dirman_private.h"
+#include "dirman_workqueue.h"
+
+struct DirManAsync::TaskState
+{
+    DirManTaskControl   control;
+    //! Does the job, called once: also for cancelled jobs to report the result
+    std::function<bool(DirManTaskControl &control)> run;
+    bool                finished = false;
+    bool                ok = false;
+#ifdef DIRMAN_HAS_STD_THREADS
+    std::mutex              mutex;
+    std::condition_variable cond;
+#endif
+
+    void execute()
+    {
+        bool result = run(control);
+        run = nullptr; // Release captured data before waiters wake up
+
+#ifdef DIRMAN_HAS_STD_THREADS
+        std::lock_guard<std::mutex> lock(mutex);
+#endif
+        ok = result;
+        finished = true;
+#ifdef DIRMAN_HAS_STD_THREADS
+        cond.notify_all();
+#endif
+    }
+};
+
+#ifdef DIRMAN_HAS_STD_THREADS
+/**
+ * @brief Worker threads started on demand and the queue of jobs
+ */
+struct DirManAsyncPool
+{
+    std::mutex              mutex;
+    std::condition_variable cond;
+    std::deque<std::shared_ptr<DirManAsync::TaskState> > jobs;
+    std::vector<std::shared_ptr<DirManAsync::TaskState> > running;
+    std::vector<std::thread> threads;
+    unsigned                idle = 0;
+    unsigned                limit = 0;
+    bool                    quit = false;
+
+    unsigned maxThreads() const
+    {
+        if(limit > 0)
+            return limit;
+
+        unsigned n = std::thread::hardware_concurrency();
+        // Storage is the bottleneck, more threads only fight for it
+        return n == 0 ? 1 : std::min(n, 4u);
+    }
+
+    void push(const std::shared_ptr<DirManAsync::TaskState> &job)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+
+        if(idle == 0 && threads.size() < maxThreads())
+            threads.emplace_back([this]{ work(); });
+        else
+            cond.notify_one();
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while(true)
+        {
+            idle++;
+            cond.wait(lock, [this]{ return quit || !jobs.empty(); });
+            idle--;
+
+            if(jobs.empty())
+                break; // Quit
+
+            std::shared_ptr<DirManAsync::TaskState> job = std::move(jobs.front());
+            jobs.pop_front();
+            running.push_back(job);
+
+            lock.unlock();
+            job->execute();
+            lock.lock();
+
+            running.erase(std::find(running.begin(), running.end(), job));
+        }
+    }
+
+    void stop()
+    {
+        std::vector<std::thread> joined;
+        std::deque<std::shared_ptr<DirManAsync::TaskState> > dropped;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+            dropped.swap(jobs);
+            for(std::shared_ptr<DirManAsync::TaskState> &job : running)
+                job->control.cancelled = true;
+            joined.swap(threads);
+            cond.notify_all();
+        }
+
+        // Report the result of every dropped job
+        for(std::shared_ptr<DirManAsync::TaskState> &job : dropped)
+        {
+            job->control.cancelled = true;
+            job->execute();
+        }
+
+        for(std::thread &t : joined)
+            t.join();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = false;
+    }
+};
+
+static DirManAsyncPool &asyncPool()
+{
+    // Never destroyed: joining workers during static destruction would run jobs against
+    // already destroyed globals. DirManAsync::shutdown() is the teardown.
+    static DirManAsyncPool *pool = new DirManAsyncPool;
+    return *pool;
+}
+#endif // DIRMAN_HAS_STD_THREADS
+
+DirManAsync::Task DirManAsync::start(std::shared_ptr<TaskState> &&job)
+{
+    Task task;
+#ifdef DIRMAN_HAS_STD_THREADS
+    asyncPool().push(job);
+#else
+    job->execute();
+#endif
+    task.m_state = std::move(job);
+    return task;
+}
+
+
+bool DirManAsync::Task::isValid() const
+{
+    return m_state.get() != nullptr;
+}
+
+bool DirManAsync::Task::isFinished() const
+{
+    if(!m_state)
+        return true;
+
+#ifdef DIRMAN_HAS_STD_THREADS
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+#endif
+    return m_state->finished;
+}
+
+void DirManAsync::Task::wait() const
+{
+#ifdef DIRMAN_HAS_STD_THREADS
+    if(!m_state)
+        return;
+
+    std::unique_lock<std::mutex> lock(m_state->mutex);
+    TaskState *s = m_state.get();
+    m_state->cond.wait(lock, [s]{ return s->finished; });
+#endif
+}
+
+void DirManAsync::Task::cancel()
+{
+    if(m_state)
+        m_state->control.cancelled = true;
+}
+
+bool DirManAsync::Task::isCancelled() const
+{
+    return m_state && m_state->control.cancelled;
+}
+
+size_t DirManAsync::Task::progress() const
+{
+    return m_state ? m_state->control.processed.load() : 0;
+}
+
+bool DirManAsync::Task::succeeded() const
+{
+    if(!m_state)
+        return false;
+
+#ifdef DIRMAN_HAS_STD_THREADS
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+#endif
+    return m_state->finished && m_state->ok;
+}
+
+
+DirManAsync::Task DirManAsync::getListOfFiles(const std::string &dirPath,
+                                              const std::vector<std::string> &suffix_filters,
+                                              const ListCallback &done)
+{
+    std::shared_ptr<TaskState> job(new TaskState);
+    job->run = [dirPath, suffix_filters, done](DirManTaskControl &control)
+    {
+        std::vector<std::string> list;
+        bool ok = !control.cancelled && DirMan(dirPath).getListOfFiles(list, suffix_filters);
+        ok &= !control.cancelled;
+        if(done)
+            done(ok, list);
+        return ok;
+    };
+
+    return start(std::move(job));
+}
+
+DirManAsync::Task DirManAsync::getListOfFolders(const std::string &dirPath,
+                                                const std::vector<std::string> &suffix_filters,
+                                                const ListCallback &done)
+{
+    std::shared_ptr<TaskState> job(new TaskState);
+    job->run = [dirPath, suffix_filters, done](DirManTaskControl &control)
+    {
+        std::vector<std::string> list;
+        bool ok = !control.cancelled && DirMan(dirPath).getListOfFolders(list, suffix_filters);
+        ok &= !control.cancelled;
+        if(done)
+            done(ok, list);
+        return ok;
+    };
+
+    return start(std::move(job));
+}
+
+#ifndef PGE_FILES_PRESENT
+DirManAsync::Task DirManAsync::walk(const std::string &dirPath,
+                                    const DirMan::WalkerOptions &options,
+                                    const std::vector<std::string> &suffix_filters,
+                                    const ListCallback &done,
+                                    const ProgressCallback &progress)
+{
+    std::shared_ptr<TaskState> job(new TaskState);
+    job->control.progress = progress;
+    job->run = [dirPath, options, suffix_filters, done](DirManTaskControl &control)
+    {
+        std::vector<std::string> list, files;
+        std::string curPath;
+        bool ok = !control.cancelled;
+
+        if(ok)
+        {
+            DirMan dir(dirPath);
+            ok = dir.beginWalking(options, suffix_filters);
+            while(ok && dir.fetchListFromWalker(curPath, files))
+            {
+                for(const std::string &f : files)
+                    list.push_back(curPath + "/" + f);
+                ok = control.step();
+            }
+        }
+
+        if(!ok)
+            list.clear();
+        if(done)
+            done(ok, list);
+        return ok;
+    };
+
+    return start(std::move(job));
+}
+#endif
+
+DirManAsync::Task DirManAsync::mkAbsPath(const std::string &dirPath, const DoneCallback &done)
+{
+    std::shared_ptr<TaskState> job(new TaskState);
+    job->run = [dirPath, done](DirManTaskControl &control)
+    {
+        bool ok = !control.cancelled && DirMan::mkAbsPath(dirPath);
+        if(done)
+            done(ok);
+        return ok;
+    };
+
+    return start(std::move(job));
+}
+
+DirManAsync::Task DirManAsync::rmAbsPath(const std::string &dirPath,
+                                         const DoneCallback &done,
+                                         const ProgressCallback &progress)
+{
+    std::shared_ptr<TaskState> job(new TaskState);
+    job->control.progress = progress;
+    // The backend of the request is used even if another one gets installed before the task runs
+    std::shared_ptr<DirManBackend> b = DirMan::DirMan_private::backend();
+    job->run = [dirPath, done, b](DirManTaskControl &control)
+    {
+        bool ok = !control.cancelled;
+
+        if(ok)
+        {
+            if(!DirMan::DirMan_private::isNative(*b))
+                ok = DirMan::DirMan_private::backendRmAbsPath(*b, dirPath, &control);
+            else
+                ok = DirMan::DirMan_private::rmAbsPath(dirPath.c_str(), &control);
+        }
+
+        if(done)
+            done(ok);
+        return ok;
+    };
+
+    return start(std::move(job));
+}
+
+void DirManAsync::setMaxThreads(unsigned threads)
+{
+#ifdef DIRMAN_HAS_STD_THREADS
+    DirManAsyncPool &pool = asyncPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.limit = threads;
+#else
+    (void)threads;
+#endif
+}
+
+unsigned DirManAsync::maxThreads()
+{
+#ifdef DIRMAN_HAS_STD_THREADS
+    DirManAsyncPool &pool = asyncPool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    return pool.maxThreads();
+#else
+    return 0;
+#endif
+}
+
+void DirManAsync::shutdown()
+{
+#ifdef DIRMAN_HAS_STD_THREADS
+    asyncPool().stop();
+#endif
+}
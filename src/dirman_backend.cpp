@@ -0,0 +1,883 @@
+/*
+ * DirMan - A small crossplatform class to manage directories
+ *
+ * Copyright (c) 2017-2026 Vitaliy Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <map>
+#include <deque>
+#include <algorithm>
+
+#include "../include/DirManager/dirman.h"
+#include "../include/DirManager/dirman_backend.h"
+#include "dirman_private.h"
+#include "dirman_workqueue.h"
+#include "dirman_hash.h"
+
+#ifdef DIRMAN_HAS_STD_THREADS
+#   include <chrono>
+#endif
+
+//! Installed backend, nullptr while the native one is in use
+static std::shared_ptr<DirManBackend> s_backend;
+
+//! Protects s_backend: callers take their own reference, so a replaced backend lives until they return
+static DirManMutex &backendMutex()
+{
+    static DirManMutex mutex;
+    return mutex;
+}
+
+//! The default backend, never destroyed: walks may still hold it during the static destruction
+static const std::shared_ptr<DirManBackend> &nativeBackend()
+{
+    static std::shared_ptr<DirManBackend> *native = new std::shared_ptr<DirManBackend>(new DirManNativeBackend);
+    return *native;
+}
+
+DirManBackend::~DirManBackend()
+{}
+
+bool DirManBackend::statEntry(DirHandle dir, const std::string &dirPath, const Entry &entry, Stat &st)
+{
+    (void)dir;
+    return stat(dirPath + "/" + entry.name, st);
+}
+
+bool DirManBackend::readFile(const std::string &path, std::string &data)
+{
+    (void)path;
+    (void)data;
+    return false;
+}
+
+void DirMan::setBackend(const std::shared_ptr<DirManBackend> &backend)
+{
+    std::shared_ptr<DirManBackend> old = backend;
+    {
+        DirManMutexLocker lock(backendMutex());
+        s_backend.swap(old);
+    }
+
+    // Names of directories may differ
+    DirMan_private::clearCaseCache();
+}
+
+std::shared_ptr<DirManBackend> DirMan::backend()
+{
+    return DirMan_private::backend();
+}
+
+std::shared_ptr<DirManBackend> DirMan::DirMan_private::backend()
+{
+    DirManMutexLocker lock(backendMutex());
+    return s_backend ? s_backend : nativeBackend();
+}
+
+bool DirMan::DirMan_private::isNative(const DirManBackend &b)
+{
+    return &b == nativeBackend().get();
+}
+
+static DirManBackend::EntryType backendEntryType(DirManBackend &b, DirManBackend::DirHandle dir,
+                                                 const std::string &dirPath, const DirManBackend::Entry &e)
+{
+    if(e.type != DirManBackend::ENTRY_UNKNOWN)
+        return e.type;
+
+    DirManBackend::Stat st;
+    if(!b.statEntry(dir, dirPath, e, st))
+        return DirManBackend::ENTRY_OTHER;
+
+    return st.type;
+}
+
+bool DirMan::DirMan_private::backendGetList(DirManBackend &b, std::vector<std::string> &list,
+                                            const DirManNameFilter &filter, bool folders)
+{
+    list.clear();
+
+    DirManBackend::DirHandle dir = b.openDir(m_dirPath);
+    if(!dir)
+        return false;
+
+    const DirManBackend::EntryType want = folders ? DirManBackend::ENTRY_DIR : DirManBackend::ENTRY_FILE;
+    DirManBackend::Entry e;
+
+    while(b.readDir(dir, e))
+    {
+        if(backendEntryType(b, dir, m_dirPath, e) != want)
+            continue;
+
+        if(filter(e.name))
+            list.push_back(e.name);
+    }
+
+    b.closeDir(dir);
+
+    return true;
+}
+
+static bool backendCountDirEntries(DirManBackend &b, const std::string &path, DirManCountQuery &q)
+{
+    DirManBackend::DirHandle dir = b.openDir(path);
+    if(!dir)
+        return false;
+
+    DirManBackend::Entry e;
+    while(!q.done() && b.readDir(dir, e))
+    {
+        // Backends report links as their targets: a tree with a link loop is not supported here
+        DirManBackend::EntryType type = backendEntryType(b, dir, path, e);
+        const bool isDir = type == DirManBackend::ENTRY_DIR;
+
+        if((q.folders ? isDir : type == DirManBackend::ENTRY_FILE) && q.filter(e.name))
+            q.count++;
+
+        if(isDir && q.recursive && !q.done())
+            backendCountDirEntries(b, path + "/" + e.name, q);
+    }
+
+    b.closeDir(dir);
+
+    return true;
+}
+
+bool DirMan::DirMan_private::backendCountEntries(DirManBackend &b, DirManCountQuery &query)
+{
+    return backendCountDirEntries(b, m_dirPath, query);
+}
+
+bool DirMan::DirMan_private::backendGetListPage(DirManBackend &b, DirManListPage &page)
+{
+    DirManBackend::DirHandle dir = b.openDir(m_dirPath);
+    if(!dir)
+        return false;
+
+    const DirManBackend::EntryType want = page.folders ? DirManBackend::ENTRY_DIR : DirManBackend::ENTRY_FILE;
+    DirManBackend::Entry e;
+    uint64_t read = 0;
+    bool more = true;
+
+    // Backends have no seekable positions: skip entries of previous pages
+    while(!page.full() && (more = b.readDir(dir, e)))
+    {
+        if(read++ < page.position)
+            continue;
+
+        if(backendEntryType(b, dir, m_dirPath, e) == want && page.filter(e.name))
+            page.list.push_back(e.name);
+    }
+
+    b.closeDir(dir);
+
+    page.position = read;
+    page.done = !more;
+
+    return true;
+}
+
+bool DirMan::DirMan_private::backendFetchListFromWalker(DirManBackend &b, std::string &curPath, std::vector<std::string> &list)
+{
+    DirWalkerState::Entry e;
+    if(!m_walkerState.popDir(e))
+        return false;
+
+    list.clear();
+
+    const std::string path = fromPathString(e.path);
+    const std::string &ignoreFile = m_walkerState.options.ignoreFileName;
+    const bool needIds = m_walkerState.needsIds();
+    bool hasIgnoreFile = false;
+    m_walkerState.subDirs.clear();
+
+    DirManBackend::DirHandle dir = b.openDir(path);
+    if(!dir) //Can't read this directory. Continue
+        return true;
+
+    DirManBackend::Stat st;
+    if(needIds && e.depth == 0 && b.stat(path, st))
+        m_walkerState.enterRoot(e, st.device, st.inode);
+
+    DirManBackend::Entry de;
+    while(b.readDir(dir, de))
+    {
+        DirManBackend::EntryType type = backendEntryType(b, dir, path, de);
+
+        if(type == DirManBackend::ENTRY_DIR)
+        {
+            // Backends report links as their targets, identifiers are needed to enter every directory once
+            if(needIds)
+            {
+                if(!b.statEntry(dir, path, de, st))
+                    continue;
+                m_walkerState.addSubDir(de.name.c_str(), st.device, st.inode);
+            }
+            else
+                m_walkerState.addSubDir(de.name.c_str());
+        }
+        else if(type == DirManBackend::ENTRY_FILE)
+        {
+            if(!ignoreFile.empty() && ignoreFile == de.name)
+                hasIgnoreFile = true;
+            if(matchSuffixFilters(de.name, m_walkerState.suffix_filters))
+                list.push_back(de.name);
+        }
+    }
+
+    b.closeDir(dir);
+
+    if(hasIgnoreFile)
+    {
+        std::string rules;
+        if(b.readFile(path + "/" + ignoreFile, rules))
+            e.rules = IgnoreRules::parse(rules, e.depth, e.rules);
+    }
+
+    m_walkerState.finishDir(e, path, list);
+    curPath = path;
+
+    return true;
+}
+
+void DirMan::DirMan_private::backendFetchBatchFromWalker(DirManBackend &b, WalkerBatch &batch)
+{
+    while(!batch.full())
+    {
+        WalkerResult &r = batch.next();
+        if(!backendFetchListFromWalker(b, r.path, r.files))
+            break;
+        batch.commit();
+    }
+}
+
+std::string DirMan::DirMan_private::backendAbsPath(const std::string &path)
+{
+    bool absolute = !path.empty() && path[0] == '/';
+#ifdef _WIN32
+    absolute |= !path.empty() && (path[0] == '\\' || (path.size() >= 2 && path[1] == ':'));
+#endif
+
+    // Backends have no current directory
+    return DirMan::cleanPath(absolute ? path : "/" + path);
+}
+
+bool DirMan::DirMan_private::backendExists(DirManBackend &b, const std::string &dirPath)
+{
+    DirManBackend::Stat st;
+    return b.stat(dirPath, st) && st.type == DirManBackend::ENTRY_DIR;
+}
+
+bool DirMan::DirMan_private::backendMkAbsPath(DirManBackend &b, const std::string &dirPath)
+{
+    std::string path = backendAbsPath(dirPath);
+
+    // Create every middle directory which doesn't exist yet
+    for(size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1))
+    {
+        std::string sub = path.substr(0, slash);
+        if(!b.mkdir(sub) && !backendExists(b, sub))
+            return false;
+    }
+
+    return b.mkdir(path);
+}
+
+bool DirMan::DirMan_private::backendMkTree(DirManBackend &b, const std::string &base, const std::vector<DirManMkNode> &nodes, size_t begin, size_t end)
+{
+    bool ok = true;
+    // Lengths of the parent paths along the current branch
+    std::vector<size_t> parents(1, base.size());
+    std::string path = base;
+    size_t baseDepth = nodes[begin].depth;
+
+    for(size_t i = begin; i < end; )
+    {
+        const DirManMkNode &n = nodes[i];
+        parents.resize(n.depth - baseDepth + 1);
+        path.resize(parents.back());
+        path.push_back('/');
+        path.append(n.name);
+
+        if(!b.mkdir(path) && !backendExists(b, path))
+        {
+            ok = false;
+            i = n.end; // Skip the sub-tree
+            continue;
+        }
+
+        parents.push_back(path.size());
+        ++i;
+    }
+
+    return ok;
+}
+
+bool DirMan::DirMan_private::backendRmAbsPath(DirManBackend &b, const std::string &dirPath, DirManTaskControl *control)
+{
+    bool ret = true;
+    std::stack<std::string> dirStack;
+    dirStack.push(dirPath);
+
+    while(!dirStack.empty())
+    {
+        const std::string path = dirStack.top();
+        bool walkUp = false;
+
+        DirManBackend::DirHandle dir = b.openDir(path);
+        if(dir)
+        {
+            DirManBackend::Entry e;
+            while(b.readDir(dir, e))
+            {
+                std::string sub = path + "/" + e.name;
+                if(backendEntryType(b, dir, path, e) == DirManBackend::ENTRY_DIR)
+                {
+                    dirStack.push(sub);
+                    walkUp = true;
+                    break;
+                }
+                else
+                {
+                    if(!b.unlink(sub))
+                        ret = false;
+                    if(control && !control->step())
+                    {
+                        b.closeDir(dir);
+                        return false;
+                    }
+                }
+            }
+            b.closeDir(dir);
+        }
+
+        if(!walkUp)
+        {
+            if(!b.rmdir(path))
+            {
+                ret = false;
+                // Don't retry the parent directory forever
+                if(dirStack.size() > 1)
+                    return false;
+            }
+            dirStack.pop();
+            if(control && !control->step())
+                return false;
+        }
+    }
+
+    return ret;
+}
+
+void DirMan::DirMan_private::setEntryInfo(EntryInfo &info, const DirManBackend::Stat &st)
+{
+    info.isDir = st.type == DirManBackend::ENTRY_DIR;
+    info.isFile = st.type == DirManBackend::ENTRY_FILE;
+    info.size = info.isFile ? st.size : 0;
+    info.mtime = st.mtime;
+    info.ctime = st.ctime;
+    info.inode = st.inode;
+}
+
+bool DirMan::DirMan_private::listDirectory(DirManBackend &b, const std::string &path, std::vector<EntryInfo> &out)
+{
+    out.clear();
+
+    DirManBackend::DirHandle dir = b.openDir(path);
+    if(!dir)
+        return false;
+
+    DirManBackend::Entry e;
+    DirManBackend::Stat st;
+
+    while(b.readDir(dir, e))
+    {
+        if(!b.statEntry(dir, path, e, st))
+            continue;
+
+        out.emplace_back();
+        EntryInfo &i = out.back();
+        i.name = e.name;
+        setEntryInfo(i, st);
+    }
+
+    b.closeDir(dir);
+
+    return true;
+}
+
+bool DirMan::DirMan_private::statPath(DirManBackend &b, const std::string &path, EntryInfo &info)
+{
+    DirManBackend::Stat st;
+    if(!b.stat(path, st))
+        return false;
+
+    setEntryInfo(info, st);
+
+    return true;
+}
+
+bool DirMan::DirMan_private::listNames(DirManBackend &b, const std::string &path, std::vector<std::string> &names)
+{
+    names.clear();
+
+    DirManBackend::DirHandle dir = b.openDir(path);
+    if(!dir)
+        return false;
+
+    DirManBackend::Entry e;
+    while(b.readDir(dir, e))
+        names.push_back(e.name);
+
+    b.closeDir(dir);
+
+    return true;
+}
+
+bool DirMan::DirMan_private::backendDiskUsage(DirManBackend &b, DiskUsage &out, unsigned threads)
+{
+    struct Job
+    {
+        size_t      node;
+        std::string path;
+    };
+
+    DirManBackend::Stat rootSt;
+    if(!b.stat(m_dirPath, rootSt) || rootSt.type != DirManBackend::ENTRY_DIR)
+        return false;
+
+    // Backends don't report allocated sizes and hard links: every file takes its size
+    std::deque<DiskUsageNode> nodes;
+    DirManMutex nodesMutex;
+    DirManWorkQueue<Job> queue;
+
+    nodes.push_back({0, m_dirPath, 0, 0, 0});
+    queue.push({0, m_dirPath});
+
+    DirManWorkQueue<Job>::run(threads, [&]()
+    {
+        Job job;
+        DirManBackend::Entry e;
+        DirManBackend::Stat st;
+
+        while(queue.pop(job))
+        {
+            DirManBackend::DirHandle dir = b.openDir(job.path);
+            if(!dir) // Can't read this directory. Continue
+            {
+                queue.done();
+                continue;
+            }
+
+            uint64_t bytes = 0, files = 0;
+
+            while(b.readDir(dir, e))
+            {
+                if(!b.statEntry(dir, job.path, e, st))
+                    continue;
+
+                if(st.type == DirManBackend::ENTRY_DIR)
+                {
+                    size_t idx;
+                    {
+                        DirManMutexLocker lock(nodesMutex);
+                        nodes.push_back({job.node, e.name, 0, 0, 0});
+                        idx = nodes.size() - 1;
+                    }
+                    queue.push({idx, job.path + "/" + e.name});
+                }
+                else if(st.type == DirManBackend::ENTRY_FILE)
+                {
+                    bytes += st.size;
+                    files++;
+                }
+            }
+
+            b.closeDir(dir);
+
+            {
+                DirManMutexLocker lock(nodesMutex);
+                DiskUsageNode &n = nodes[job.node];
+                n.bytes += bytes;
+                n.apparentBytes += bytes;
+                n.files += files;
+            }
+
+            queue.done();
+        }
+    });
+
+    buildDiskUsage(nodes, out);
+
+    return true;
+}
+
+bool DirMan::DirMan_private::backendFingerprintFile(DirManBackend &b, FileFingerprint &fp, const FileFingerprint *prev)
+{
+    DirManBackend::Stat st;
+    if(!b.stat(fp.path, st) || st.type != DirManBackend::ENTRY_FILE)
+        return false;
+
+    fp.size = st.size;
+    fp.mtime = st.mtime;
+    fp.inode = st.inode;
+
+    // Time is 0 where the backend doesn't report it: such files are hashed every time
+    if(fp.mtime != 0 && reuseFingerprint(fp, prev))
+        return true;
+
+    std::string data;
+    if(!b.readFile(fp.path, data))
+        return false;
+
+    DirManHash64 hash;
+    hash.update(data.data(), data.size());
+    fp.hash = hash.digest();
+    fp.reused = false;
+
+    return true;
+}
+
+
+/* ======================== In-memory backend ======================== */
+
+struct DirManMemoryBackend::Impl
+{
+    struct Node
+    {
+        bool        isDir = true;
+        std::string data;
+        int64_t     mtime = 0;
+        uint64_t    inode = 0;
+        std::map<std::string, std::unique_ptr<Node>> children;
+    };
+
+    struct OpenedDir
+    {
+        std::vector<DirManBackend::Entry> entries;
+        size_t pos = 0;
+    };
+
+    Node        root;
+    DirManMutex mutex;
+    uint32_t    latency[OP_COUNT] = {};
+    uint64_t    counts[OP_COUNT] = {};
+    uint64_t    simulated = 0;
+    bool        realDelays = false;
+    uint64_t    nextInode = 2;
+    //! Logical clock used as the modification time of changed entries
+    int64_t     clock = 0;
+
+    void account(Operation op)
+    {
+        uint32_t wait;
+        {
+            DirManMutexLocker lock(mutex);
+            counts[op]++;
+            simulated += latency[op];
+            wait = realDelays ? latency[op] : 0;
+        }
+
+#ifdef DIRMAN_HAS_STD_THREADS
+        if(wait > 0)
+            std::this_thread::sleep_for(std::chrono::microseconds(wait));
+#else
+        (void)wait;
+#endif
+    }
+
+    static void split(const std::string &path, std::vector<std::string> &out)
+    {
+        out.clear();
+        size_t pos = 0;
+
+        while(pos <= path.size())
+        {
+            size_t end = path.find('/', pos);
+            if(end == std::string::npos)
+                end = path.size();
+
+            std::string c = path.substr(pos, end - pos);
+            pos = end + 1;
+
+            if(c.empty() || c == ".")
+                continue;
+            else if(c == "..")
+            {
+                if(!out.empty())
+                    out.pop_back();
+            }
+            else
+                out.push_back(c);
+        }
+    }
+
+    //! Find the node, must be called under the mutex
+    Node *find(const std::string &path)
+    {
+        std::vector<std::string> parts;
+        split(path, parts);
+
+        Node *n = &root;
+        for(const std::string &c : parts)
+        {
+            if(!n->isDir)
+                return nullptr;
+            auto it = n->children.find(c);
+            if(it == n->children.end())
+                return nullptr;
+            n = it->second.get();
+        }
+
+        return n;
+    }
+
+    //! Find the parent directory of the path and the name of the last component, must be called under the mutex
+    Node *findParent(const std::string &path, std::string &name)
+    {
+        std::vector<std::string> parts;
+        split(path, parts);
+
+        if(parts.empty())
+            return nullptr;
+
+        name = parts.back();
+        parts.pop_back();
+
+        Node *n = &root;
+        for(const std::string &c : parts)
+        {
+            auto it = n->children.find(c);
+            if(it == n->children.end() || !it->second->isDir)
+                return nullptr;
+            n = it->second.get();
+        }
+
+        return n;
+    }
+};
+
+DirManMemoryBackend::DirManMemoryBackend() :
+    p(new Impl)
+{
+    p->root.inode = 1;
+}
+
+DirManMemoryBackend::~DirManMemoryBackend()
+{}
+
+bool DirManMemoryBackend::addFile(const std::string &path, const std::string &data, int64_t mtime)
+{
+    DirManMutexLocker lock(p->mutex);
+
+    std::vector<std::string> parts;
+    Impl::split(path, parts);
+    if(parts.empty())
+        return false;
+
+    p->clock++;
+
+    Impl::Node *n = &p->root;
+    for(size_t i = 0; i < parts.size(); ++i)
+    {
+        const bool last = (i == parts.size() - 1);
+        auto it = n->children.find(parts[i]);
+
+        if(it == n->children.end())
+        {
+            std::unique_ptr<Impl::Node> sub(new Impl::Node);
+            sub->isDir = !last;
+            sub->inode = p->nextInode++;
+            sub->mtime = p->clock;
+            n->mtime = p->clock;
+            it = n->children.insert(std::make_pair(parts[i], std::move(sub))).first;
+        }
+        else if(it->second->isDir == last)
+            return false; // A file in the middle, or a directory at the end
+
+        n = it->second.get();
+    }
+
+    n->data = data;
+    n->mtime = mtime != 0 ? mtime : p->clock;
+
+    return true;
+}
+
+void DirManMemoryBackend::setLatency(Operation op, uint32_t microseconds)
+{
+    DirManMutexLocker lock(p->mutex);
+    if(op >= 0 && op < OP_COUNT)
+        p->latency[op] = microseconds;
+}
+
+void DirManMemoryBackend::setRealDelays(bool enabled)
+{
+    DirManMutexLocker lock(p->mutex);
+    p->realDelays = enabled;
+}
+
+uint64_t DirManMemoryBackend::simulatedTime() const
+{
+    DirManMutexLocker lock(p->mutex);
+    return p->simulated;
+}
+
+uint64_t DirManMemoryBackend::operationsCount(Operation op) const
+{
+    DirManMutexLocker lock(p->mutex);
+    return (op >= 0 && op < OP_COUNT) ? p->counts[op] : 0;
+}
+
+void DirManMemoryBackend::resetCounters()
+{
+    DirManMutexLocker lock(p->mutex);
+    std::fill(p->counts, p->counts + OP_COUNT, 0);
+    p->simulated = 0;
+}
+
+DirManBackend::DirHandle DirManMemoryBackend::openDir(const std::string &path)
+{
+    p->account(OP_OPEN_DIR);
+    DirManMutexLocker lock(p->mutex);
+
+    Impl::Node *n = p->find(path);
+    if(!n || !n->isDir)
+        return nullptr;
+
+    Impl::OpenedDir *d = new Impl::OpenedDir;
+    d->entries.reserve(n->children.size());
+    for(auto &c : n->children)
+    {
+        d->entries.emplace_back();
+        d->entries.back().name = c.first;
+        d->entries.back().type = c.second->isDir ? ENTRY_DIR : ENTRY_FILE;
+    }
+
+    return d;
+}
+
+bool DirManMemoryBackend::readDir(DirHandle dir, Entry &entry)
+{
+    Impl::OpenedDir *d = static_cast<Impl::OpenedDir*>(dir);
+    if(d->pos >= d->entries.size())
+        return false;
+
+    p->account(OP_READ_DIR);
+    entry = d->entries[d->pos++];
+
+    return true;
+}
+
+void DirManMemoryBackend::closeDir(DirHandle dir)
+{
+    delete static_cast<Impl::OpenedDir*>(dir);
+}
+
+bool DirManMemoryBackend::stat(const std::string &path, Stat &st)
+{
+    p->account(OP_STAT);
+    DirManMutexLocker lock(p->mutex);
+
+    Impl::Node *n = p->find(path);
+    if(!n)
+        return false;
+
+    st.type = n->isDir ? ENTRY_DIR : ENTRY_FILE;
+    st.size = n->isDir ? 0 : n->data.size();
+    st.mtime = n->mtime;
+    st.device = 1;
+    st.inode = n->inode;
+
+    return true;
+}
+
+bool DirManMemoryBackend::mkdir(const std::string &path)
+{
+    p->account(OP_MKDIR);
+    DirManMutexLocker lock(p->mutex);
+
+    std::string name;
+    Impl::Node *parent = p->findParent(path, name);
+    if(!parent || parent->children.find(name) != parent->children.end())
+        return false;
+
+    std::unique_ptr<Impl::Node> sub(new Impl::Node);
+    sub->inode = p->nextInode++;
+    sub->mtime = ++p->clock;
+    parent->mtime = p->clock;
+    parent->children.insert(std::make_pair(name, std::move(sub)));
+
+    return true;
+}
+
+bool DirManMemoryBackend::rmdir(const std::string &path)
+{
+    p->account(OP_RMDIR);
+    DirManMutexLocker lock(p->mutex);
+
+    std::string name;
+    Impl::Node *parent = p->findParent(path, name);
+    if(!parent)
+        return false;
+
+    auto it = parent->children.find(name);
+    if(it == parent->children.end() || !it->second->isDir || !it->second->children.empty())
+        return false;
+
+    parent->children.erase(it);
+    parent->mtime = ++p->clock;
+
+    return true;
+}
+
+bool DirManMemoryBackend::unlink(const std::string &path)
+{
+    p->account(OP_UNLINK);
+    DirManMutexLocker lock(p->mutex);
+
+    std::string name;
+    Impl::Node *parent = p->findParent(path, name);
+    if(!parent)
+        return false;
+
+    auto it = parent->children.find(name);
+    if(it == parent->children.end() || it->second->isDir)
+        return false;
+
+    parent->children.erase(it);
+    parent->mtime = ++p->clock;
+
+    return true;
+}
+
+bool DirManMemoryBackend::readFile(const std::string &path, std::string &data)
+{
+    p->account(OP_READ_FILE);
+    DirManMutexLocker lock(p->mutex);
+
+    Impl::Node *n = p->find(path);
+    if(!n || n->isDir)
+        return false;
+
+    data = n->data;
+    return true;
+}
@@ -0,0 +1,198 @@
+/*
+ * DirMan - A small crossplatform class to manage directories
+ *
+ * Copyright (c) 2017-2026 Vitaliy Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DIRMAN_HASH_H
+#define DIRMAN_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * @brief Streaming implementation of the XXH64 non-cryptographic hash
+ */
+class DirManHash64
+{
+    static constexpr uint64_t P1 = 11400714785074694791ULL;
+    static constexpr uint64_t P2 = 14029467366897019727ULL;
+    static constexpr uint64_t P3 = 1609587929392839161ULL;
+    static constexpr uint64_t P4 = 9650029242287828579ULL;
+    static constexpr uint64_t P5 = 2870177450012600261ULL;
+
+    uint64_t m_v[4];
+    uint64_t m_seed;
+    uint64_t m_total = 0;
+    unsigned char m_buf[32];
+    size_t   m_bufSize = 0;
+
+    static inline uint64_t rotl(uint64_t x, int r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static inline uint64_t read64(const unsigned char *p)
+    {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        v = __builtin_bswap64(v);
+#endif
+        return v;
+    }
+
+    static inline uint32_t read32(const unsigned char *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+        v = __builtin_bswap32(v);
+#endif
+        return v;
+    }
+
+    static inline uint64_t round(uint64_t acc, uint64_t input)
+    {
+        acc += input * P2;
+        acc = rotl(acc, 31);
+        return acc * P1;
+    }
+
+    static inline uint64_t mergeRound(uint64_t acc, uint64_t val)
+    {
+        acc ^= round(0, val);
+        return acc * P1 + P4;
+    }
+
+    inline void stripe(const unsigned char *p)
+    {
+        m_v[0] = round(m_v[0], read64(p));
+        m_v[1] = round(m_v[1], read64(p + 8));
+        m_v[2] = round(m_v[2], read64(p + 16));
+        m_v[3] = round(m_v[3], read64(p + 24));
+    }
+
+public:
+    explicit DirManHash64(uint64_t seed = 0)
+    {
+        reset(seed);
+    }
+
+    void reset(uint64_t seed = 0)
+    {
+        m_seed = seed;
+        m_v[0] = seed + P1 + P2;
+        m_v[1] = seed + P2;
+        m_v[2] = seed;
+        m_v[3] = seed - P1;
+        m_total = 0;
+        m_bufSize = 0;
+    }
+
+    void update(const void *data, size_t len)
+    {
+        const unsigned char *p = static_cast<const unsigned char *>(data);
+        const unsigned char *end = p + len;
+        m_total += len;
+
+        if(m_bufSize + len < 32)
+        {
+            memcpy(m_buf + m_bufSize, p, len);
+            m_bufSize += len;
+            return;
+        }
+
+        if(m_bufSize > 0)
+        {
+            size_t fill = 32 - m_bufSize;
+            memcpy(m_buf + m_bufSize, p, fill);
+            stripe(m_buf);
+            p += fill;
+            m_bufSize = 0;
+        }
+
+        for(; p + 32 <= end; p += 32)
+            stripe(p);
+
+        m_bufSize = static_cast<size_t>(end - p);
+        memcpy(m_buf, p, m_bufSize);
+    }
+
+    void update(uint64_t value)
+    {
+        unsigned char b[8];
+        for(int i = 0; i < 8; ++i)
+            b[i] = static_cast<unsigned char>(value >> (i * 8));
+        update(b, sizeof(b));
+    }
+
+    uint64_t digest() const
+    {
+        uint64_t h;
+
+        if(m_total >= 32)
+        {
+            h = rotl(m_v[0], 1) + rotl(m_v[1], 7) + rotl(m_v[2], 12) + rotl(m_v[3], 18);
+            h = mergeRound(h, m_v[0]);
+            h = mergeRound(h, m_v[1]);
+            h = mergeRound(h, m_v[2]);
+            h = mergeRound(h, m_v[3]);
+        }
+        else
+            h = m_seed + P5;
+
+        h += m_total;
+
+        const unsigned char *p = m_buf;
+        const unsigned char *end = m_buf + m_bufSize;
+
+        for(; p + 8 <= end; p += 8)
+        {
+            h ^= round(0, read64(p));
+            h = rotl(h, 27) * P1 + P4;
+        }
+
+        if(p + 4 <= end)
+        {
+            h ^= static_cast<uint64_t>(read32(p)) * P1;
+            h = rotl(h, 23) * P2 + P3;
+            p += 4;
+        }
+
+        for(; p < end; ++p)
+        {
+            h ^= (*p) * P5;
+            h = rotl(h, 11) * P1;
+        }
+
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        h ^= h >> 32;
+
+        return h;
+    }
+};
+
+#endif // DIRMAN_HASH_H
@@ -0,0 +1,152 @@
+/*
+ * DirMan - A small crossplatform class to manage directories
+ *
+ * Copyright (c) 2017-2026 Vitaliy Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DIRMAN_PATHBUILDER_H
+#define DIRMAN_PATHBUILDER_H
+
+#include <string>
+#include <vector>
+#include <string.h>
+#include <limits.h>
+
+#ifndef PATH_MAX
+#   define PATH_MAX 4096
+#endif
+
+/**
+ * @brief Path with an inline storage of PATH_MAX bytes
+ *
+ * Appending and removing path components doesn't allocate memory unless the
+ * path grows over PATH_MAX bytes, then the path is moved into a heap buffer.
+ * Keep it on the stack: the object is big.
+ */
+class DirManPathBuilder
+{
+    char   m_inline[PATH_MAX + 1];
+    std::vector<char> m_heap;
+    char  *m_data;
+    size_t m_size = 0;
+    size_t m_capacity = PATH_MAX;
+
+    DirManPathBuilder(const DirManPathBuilder &) = delete;
+    DirManPathBuilder &operator=(const DirManPathBuilder &) = delete;
+
+    void reserve(size_t size)
+    {
+        if(size <= m_capacity)
+            return;
+
+        size_t cap = m_capacity * 2;
+        while(cap < size)
+            cap *= 2;
+
+        std::vector<char> buf(cap + 1);
+        memcpy(buf.data(), m_data, m_size + 1);
+        m_heap.swap(buf);
+        m_data = m_heap.data();
+        m_capacity = cap;
+    }
+
+public:
+    DirManPathBuilder() : m_data(m_inline)
+    {
+        m_inline[0] = '\0';
+    }
+
+    explicit DirManPathBuilder(const std::string &path) : m_data(m_inline)
+    {
+        assign(path.c_str(), path.size());
+    }
+
+    void assign(const char *path, size_t len)
+    {
+        m_size = 0;
+        reserve(len);
+        memcpy(m_data, path, len);
+        m_size = len;
+        m_data[m_size] = '\0';
+    }
+
+    /**
+     * @brief Append a path component, separated by a slash
+     * @return Size of the path before the call, pass to pop() to remove the component
+     */
+    size_t push(const char *name, size_t len)
+    {
+        size_t mark = m_size;
+        bool slash = m_size == 0 || m_data[m_size - 1] != '/';
+        reserve(m_size + len + 1);
+        if(slash)
+            m_data[m_size++] = '/';
+        memcpy(m_data + m_size, name, len);
+        m_size += len;
+        m_data[m_size] = '\0';
+        return mark;
+    }
+
+    size_t push(const char *name)
+    {
+        return push(name, strlen(name));
+    }
+
+    size_t push(const std::string &name)
+    {
+        return push(name.c_str(), name.size());
+    }
+
+    //! Truncate the path back to the size returned by push()
+    void pop(size_t mark)
+    {
+        m_size = mark;
+        m_data[m_size] = '\0';
+    }
+
+    //! Remove the last path component, the root slash is kept
+    void pop()
+    {
+        size_t i = m_size;
+        while(i > 0 && m_data[i - 1] != '/')
+            i--;
+        if(i > 1)
+            i--; // Remove the separator too, but keep the root
+        pop(i);
+    }
+
+    char *data()
+    {
+        return m_data;
+    }
+
+    const char *c_str() const
+    {
+        return m_data;
+    }
+
+    size_t size() const
+    {
+        return m_size;
+    }
+};
+
+#endif // DIRMAN_PATHBUILDER_H
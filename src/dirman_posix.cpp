@@ -28,11 +28,20 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
 #include <unistd.h>
 #include <memory.h>
 
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+
 #include "../include/DirManager/dirman.h"
 #include "dirman_private.h"
+#include "dirman_workqueue.h"
+#include "dirman_hash.h"
+#include "dirman_pathbuilder.h"
 
 #if defined(__APPLE__) && MAC_OS_X_VERSION_MAX_ALLOWED < 1010 && defined(DIRMAN_HAS_FSSTATAT)
 #   undef DIRMAN_HAS_FSSTATAT  /*This call isn't available at macOS older than 10.10 */
@@ -42,6 +51,26 @@
 #   include "Archives/archives.h"
 #endif
 
+#if defined(__linux__) && defined(DIRMAN_HAS_FSSTATAT) && defined(STATX_BLOCKS)
+#   define DIRMAN_HAS_STATX
+#endif
+
+#if defined(__linux__)
+#   include <sys/syscall.h>
+#   ifdef SYS_getdents64
+#       define DIRMAN_HAS_GETDENTS64
+#   endif
+#endif
+
+#if defined(__linux__)
+#   include <sys/vfs.h>
+#   define DIRMAN_HAS_STATFS_MAGIC
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#   include <sys/param.h>
+#   include <sys/mount.h>
+#   define DIRMAN_HAS_STATFS_TYPENAME
+#endif
+
 #ifdef __WIIU__
 // Workaround to avoid the EIO error on virtual directories
 
@@ -81,6 +110,132 @@ static int get_sys_path_offset(const std::string &dirPath)
 }
 #endif
 
+PathString DirMan::DirMan_private::toPathString(const std::string &path)
+{
+    return path;
+}
+
+std::string DirMan::DirMan_private::fromPathString(const PathString &path)
+{
+    return path;
+}
+
+#ifdef DIRMAN_HAS_REALPATH
+//! Lexical absolute paths of recently resolved directories and their real paths
+static std::unordered_map<std::string, std::string> s_resolvedPaths;
+static const size_t s_resolvedPathsMax = 256;
+
+static void cacheResolvedPath(const std::string &lexical, const std::string &real)
+{
+    // Keep the cache bounded: the working set of most programs is a few roots
+    if(s_resolvedPaths.size() >= s_resolvedPathsMax)
+        s_resolvedPaths.clear();
+    s_resolvedPaths[lexical] = real;
+}
+
+/*
+ * Same result as realpath() for existing paths. Path components are checked
+ * one by one with lstat() starting after the longest already resolved parent
+ * directory, symbolic links are resolved by realpath(). The rest of a path
+ * which doesn't exist is appended lexically.
+ */
+static std::string resolvePathCached(const std::string &dirPath)
+{
+    std::string lex;
+    if(dirPath.empty() || dirPath[0] != '/')
+    {
+        char cwd[PATH_MAX];
+        if(!getcwd(cwd, PATH_MAX))
+            return dirPath;
+        lex = cwd;
+    }
+
+    // Ends of components in the lexical path, `.` and empty components are removed
+    std::vector<size_t> ends;
+    size_t i = 0;
+    std::string tail = lex.empty() ? dirPath : lex + "/" + dirPath;
+    lex.clear();
+    lex.reserve(tail.size());
+
+    while(i < tail.size())
+    {
+        while(i < tail.size() && tail[i] == '/')
+            i++;
+        size_t begin = i;
+        while(i < tail.size() && tail[i] != '/')
+            i++;
+        if(i == begin || (i - begin == 1 && tail[begin] == '.'))
+            continue;
+        lex.push_back('/');
+        lex.append(tail, begin, i - begin);
+        ends.push_back(lex.size());
+    }
+
+    // Find the longest resolved parent
+    size_t done = ends.size();
+    std::string resolved;
+    for(; done > 0; --done)
+    {
+        auto it = s_resolvedPaths.find(lex.substr(0, ends[done - 1]));
+        if(it != s_resolvedPaths.end())
+        {
+            // The root directory is kept as an empty string while resolving
+            resolved = it->second == "/" ? std::string() : it->second;
+            break;
+        }
+    }
+
+    for(size_t c = done; c < ends.size(); ++c)
+    {
+        size_t begin = (c > 0 ? ends[c - 1] : 0) + 1;
+        size_t len = ends[c] - begin;
+
+        if(len == 2 && lex[begin] == '.' && lex[begin + 1] == '.')
+        {
+            // The resolved path is real: its parent is the physical parent
+            size_t slash = resolved.find_last_of('/');
+            resolved.resize(slash == std::string::npos ? 0 : slash);
+        }
+        else
+        {
+            std::string next = resolved + "/";
+            next.append(lex, begin, len);
+
+            struct stat st;
+            if(lstat(next.c_str(), &st) < 0)
+            {
+                // Doesn't exist: nothing to resolve
+                return DirMan::cleanPath(next + lex.substr(ends[c]));
+            }
+
+            if(S_ISLNK(st.st_mode))
+            {
+                char rp[PATH_MAX];
+                if(!realpath(next.c_str(), rp))
+                    return DirMan::cleanPath(next + lex.substr(ends[c]));
+                next = rp;
+                if(next == "/")
+                    next.clear();
+            }
+
+            resolved = std::move(next);
+        }
+
+        cacheResolvedPath(lex.substr(0, ends[c]), resolved.empty() ? "/" : resolved);
+    }
+
+    return resolved.empty() ? "/" : resolved;
+}
+#endif
+
+void DirMan::DirMan_private::clearPathCache()
+{
+#ifdef DIRMAN_HAS_REALPATH
+    PUT_THREAD_GUARD();
+    s_resolvedPaths.clear();
+#endif
+}
+
 void DirMan::DirMan_private::setPath(const std::string &dirPath)
 {
 #ifdef PGE_USE_ARCHIVES
@@ -97,15 +252,33 @@ void DirMan::DirMan_private::setPath(const std::string &dirPath)
 #endif // PGE_USE_ARCHIVES
 
 #ifdef DIRMAN_HAS_REALPATH
-    char rp[PATH_MAX];
-    memset(rp, 0, PATH_MAX);
-    char* realPath = realpath(dirPath.c_str(), rp);
-    (void)realPath;
-
-    if(strlen(rp) > 0)
-        m_dirPath = rp;
-    else // If failed
-        m_dirPath = dirPath;
+    if(s_pathResolution == DirMan::PATH_RESOLVE_CACHED)
+    {
+        PUT_THREAD_GUARD();
+        m_dirPath = resolvePathCached(dirPath);
+    }
+    else if(s_pathResolution == DirMan::PATH_RESOLVE_LEXICAL)
+    {
+        if(!dirPath.empty() && dirPath[0] == '/')
+            m_dirPath = DirMan::cleanPath(dirPath);
+        else
+        {
+            char cwd[PATH_MAX];
+            m_dirPath = DirMan::cleanPath(getcwd(cwd, PATH_MAX) ? std::string(cwd) + "/" + dirPath : dirPath);
+        }
+    }
+    else
+    {
+        char rp[PATH_MAX];
+        memset(rp, 0, PATH_MAX);
+        char* realPath = realpath(dirPath.c_str(), rp);
+        (void)realPath;
+
+        if(strlen(rp) > 0)
+            m_dirPath = rp;
+        else // If failed
+            m_dirPath = dirPath;
+    }
 #else
     m_dirPath = dirPath;
 
@@ -114,67 +287,216 @@ void DirMan::DirMan_private::setPath(const std::string &dirPath)
 #endif
 
     delEnd(m_dirPath, '/');
+
+    // Keep the root directory
+    if(m_dirPath.empty() && !dirPath.empty() && dirPath[0] == '/')
+        m_dirPath = "/";
 }
 
-bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, const std::vector<std::string> &suffix_filters)
+/**
+ * @brief The entry is a regular file or a directory
+ * @param dirFd Descriptor of the directory, used when d_type doesn't tell the type
+ * @param name Name of the entry
+ * @param type d_type of the entry
+ * @param folders Look for directories instead of files
+ *
+ * Links are resolved to their targets, d_type of other entries tells the same as a stat call.
+ */
+static inline bool isListedEntry(int dirFd, const char *name, unsigned char type, bool folders)
 {
-    list.clear();
+#ifdef DIRMAN_HAS_FSSTATAT
+    if(type == DT_UNKNOWN || type == DT_LNK)
+    {
+        struct stat st;
+        if(fstatat(dirFd, name, &st, 0) < 0)
+            return false;
+        return folders ? S_ISDIR(st.st_mode) : S_ISREG(st.st_mode);
+    }
+#else
+    (void)dirFd;
+    (void)name;
+#endif
 
-#ifdef PGE_USE_ARCHIVES
-    if(Archives::has_prefix(m_dirPath))
+    return type == (folders ? DT_DIR : DT_REG);
+}
+
+#ifdef DIRMAN_HAS_GETDENTS64
+/**
+ * @brief Reader of directory records straight from the kernel with a growing buffer
+ *
+ * Each getdents64 call fills the buffer with as many records as fit. Small directories
+ * fit into the first buffer, while a giant one keeps filling it up, so the buffer is doubled
+ * to take more records per call.
+ */
+class DirManDirReader
+{
+    struct Record
     {
-        for(auto& ent : Archives::list_dir(m_dirPath.c_str()))
+        uint64_t        ino;
+        int64_t         off;
+        unsigned short  reclen;
+        unsigned char   type;
+        char            name[1];
+    };
+
+    int     m_fd;
+    size_t  m_capacity = 32 * 1024;
+    std::unique_ptr<char[]> m_buffer;
+    size_t  m_length = 0;
+    size_t  m_pos = 0;
+    //! Count of met "." and ".." records: names are not compared once both are found
+    int     m_dots = 0;
+    //! Position of the record after the last read one
+    uint64_t m_offset = 0;
+
+public:
+    explicit DirManDirReader(int fd) :
+        m_fd(fd), m_buffer(new char[m_capacity])
+    {}
+
+    /**
+     * @brief Continue reading from the position returned by offset()
+     *
+     * The position is the d_off value of the file system, it stays valid for
+     * other descriptors of the same directory.
+     */
+    bool seek(uint64_t offset)
+    {
+        m_length = m_pos = 0;
+        m_offset = offset;
+        return ::lseek(m_fd, static_cast<off_t>(offset), SEEK_SET) != static_cast<off_t>(-1);
+    }
+
+    uint64_t offset() const
+    {
+        return m_offset;
+    }
+
+    /**
+     * @brief Take the next entry except "." and ".."
+     * @param name Name of the entry, valid until the next call
+     * @param type d_type of the entry
+     * @return false at the end of the directory or on error
+     */
+    bool next(const char *&name, unsigned char &type)
+    {
+        while(true)
         {
-            if(ent.type != Archives::PATH_FILE)
-                continue;
+            if(m_pos >= m_length)
+            {
+                if(m_length > m_capacity / 2 && m_capacity < 1024 * 1024)
+                {
+                    m_capacity *= 2;
+                    m_buffer.reset(new char[m_capacity]);
+                }
+
+                long got = syscall(SYS_getdents64, m_fd, m_buffer.get(), m_capacity);
+                if(got <= 0)
+                    return false;
+
+                m_length = static_cast<size_t>(got);
+                m_pos = 0;
+            }
+
+            const Record *r = reinterpret_cast<const Record *>(m_buffer.get() + m_pos);
+            m_pos += r->reclen;
+            m_offset = static_cast<uint64_t>(r->off);
 
-            if(!matchSuffixFilters(ent.name, suffix_filters))
+            if(m_dots < 2 && isDotName(r->name))
+            {
+                m_dots++;
                 continue;
+            }
 
-            list.push_back(std::move(ent.name));
+            name = r->name;
+            type = r->type;
+            return true;
         }
-        return true;
     }
-#endif // PGE_USE_ARCHIVES
+};
+#endif // DIRMAN_HAS_GETDENTS64
 
-    dirent *dent = nullptr;
-    DIR *srcdir = opendir(m_dirPath.c_str());
+/**
+ * @brief Reserve the list for all sub-directories of a giant directory
+ * @param dirFd Descriptor of the directory
+ * @param list The list to reserve
+ *
+ * Link count of a directory is the count of its sub-directories plus two on most file
+ * systems. The size of a directory tells nothing reliable about the count of files:
+ * it never shrinks on ext4 and XFS, and it's arbitrary on FUSE or network file systems.
+ * The reservation is capped, larger lists grow from the entries actually read.
+ */
+static void presizeFolderList(int dirFd, std::vector<std::string> &list)
+{
+    struct stat st;
+    if(fstat(dirFd, &st) < 0 || st.st_nlink <= 2)
+        return;
 
-    if(srcdir == nullptr)
+    size_t expected = static_cast<size_t>(st.st_nlink) - 2;
+    if(expected >= 4096)
+        list.reserve(std::min(expected, static_cast<size_t>(64 * 1024)));
+}
+
+/**
+ * @brief Names of files or directories of the directory which pass the filter
+ * @return false if the directory can't be read
+ */
+static bool listDirEntries(const char *path, std::vector<std::string> &list, const DirManNameFilter &filter, bool folders)
+{
+#ifdef DIRMAN_HAS_GETDENTS64
+    int fd = ::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0)
         return false;
 
-    while((dent = readdir(srcdir)) != nullptr)
-    {
-#ifdef DIRMAN_HAS_FSSTATAT
-        struct stat st = {};
-#endif
+    if(folders && filter.acceptsAll())
+        presizeFolderList(fd, list);
 
-        if(strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0)
-            continue;
+    DirManDirReader reader(fd);
+    const char *name;
+    unsigned char type;
 
-#ifdef DIRMAN_HAS_FSSTATAT
-        if(fstatat(dirfd(srcdir), dent->d_name, &st, 0) < 0)
-            continue;
+    while(reader.next(name, type))
+    {
+        if(isListedEntry(fd, name, type, folders) && filter(name))
+            list.emplace_back(name);
+    }
 
-        if(S_ISREG(st.st_mode))
-        {
-            if(matchSuffixFilters(dent->d_name, suffix_filters))
-                list.emplace_back(dent->d_name);
-        }
+    ::close(fd);
 #else
-        if(dent->d_type == DT_REG)
+    DIR *srcdir = opendir(path);
+    if(srcdir == nullptr)
+        return false;
+
+#   ifdef DIRMAN_HAS_FSSTATAT
+    const int fd = dirfd(srcdir);
+    if(folders && filter.acceptsAll())
+        presizeFolderList(fd, list);
+#   else
+    const int fd = -1;
+#   endif
+
+    dirent *dent = nullptr;
+    int dots = 0;
+
+    while((dent = readdir(srcdir)) != nullptr)
+    {
+        if(dots < 2 && isDotName(dent->d_name))
         {
-            if(matchSuffixFilters(dent->d_name, suffix_filters))
-                list.emplace_back(dent->d_name);
+            dots++;
+            continue;
         }
-#endif
+
+        if(isListedEntry(fd, dent->d_name, dent->d_type, folders) && filter(dent->d_name))
+            list.emplace_back(dent->d_name);
     }
 
     closedir(srcdir);
+#endif
+
     return true;
 }
 
-bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string>& list, const std::vector<std::string>& suffix_filters)
+bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, const DirManNameFilter &filter)
 {
     list.clear();
 
@@ -183,10 +505,10 @@ bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string>& list, co
     {
         for(auto& ent : Archives::list_dir(m_dirPath.c_str()))
         {
-            if(ent.type != Archives::PATH_DIR)
+            if(ent.type != Archives::PATH_FILE)
                 continue;
 
-            if(!matchSuffixFilters(ent.name, suffix_filters))
+            if(!filter(ent.name))
                 continue;
 
             list.push_back(std::move(ent.name));
@@ -195,146 +517,676 @@ bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string>& list, co
     }
 #endif // PGE_USE_ARCHIVES
 
-    dirent *dent = nullptr;
-    DIR *srcdir = opendir(m_dirPath.c_str());
+    return listDirEntries(m_dirPath.c_str(), list, filter, false);
+}
 
-    if(srcdir == nullptr)
-        return false;
+bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string> &list, const DirManNameFilter &filter)
+{
+    list.clear();
 
-    while((dent = readdir(srcdir)) != nullptr)
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(m_dirPath))
     {
-#ifdef DIRMAN_HAS_FSSTATAT
-        struct stat st = {};
-#endif
-        if(strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0)
-            continue;
+        for(auto& ent : Archives::list_dir(m_dirPath.c_str()))
+        {
+            if(ent.type != Archives::PATH_DIR)
+                continue;
 
-#ifdef DIRMAN_HAS_FSSTATAT
-        if(fstatat(dirfd(srcdir), dent->d_name, &st, 0) < 0)
-            continue;
+            if(!filter(ent.name))
+                continue;
 
-        if(S_ISDIR(st.st_mode))
-        {
-            if(matchSuffixFilters(dent->d_name, suffix_filters))
-                list.emplace_back(dent->d_name);
-        }
-#else
-        if(dent->d_type == DT_DIR)
-        {
-            if(matchSuffixFilters(dent->d_name, suffix_filters))
-                list.emplace_back(dent->d_name);
+            list.push_back(std::move(ent.name));
         }
-#endif
+        return true;
     }
+#endif // PGE_USE_ARCHIVES
 
-    closedir(srcdir);
-
-    return true;
+    return listDirEntries(m_dirPath.c_str(), list, filter, true);
 }
 
-bool DirMan::DirMan_private::fetchListFromWalker(std::string &curPath, std::vector<std::string> &list)
+#ifdef PGE_USE_ARCHIVES
+static void countArchiveEntries(const std::string &path, DirManCountQuery &q)
 {
-    PUT_THREAD_GUARD();
+    for(auto& ent : Archives::list_dir(path.c_str()))
+    {
+        if(q.done())
+            return;
 
-#ifdef PGE_USE_ARCHIVES
-    // unsupported for now
-    if(Archives::has_prefix(m_dirPath))
-        return false;
+        bool isDir = ent.type == Archives::PATH_DIR;
+        if((q.folders ? isDir : ent.type == Archives::PATH_FILE) && q.filter(ent.name))
+            q.count++;
+
+        if(isDir && q.recursive)
+            countArchiveEntries(path + "/" + ent.name, q);
+    }
+}
 #endif // PGE_USE_ARCHIVES
 
-    if(m_walkerState.digStack.empty())
+/**
+ * @brief Count entries of the directory and its sub-directories
+ * @param path Path to the directory, components are appended and removed on the way down
+ * @param q The query
+ * @return false if the directory can't be read
+ *
+ * Only one directory stream per level is open at once, names never get copied.
+ */
+static bool countDirEntries(DirManPathBuilder &path, DirManCountQuery &q)
+{
+    DIR *srcdir = opendir(path.c_str());
+    if(srcdir == nullptr)
         return false;
 
-    list.clear();
-
-    std::string path = m_walkerState.digStack.top();
-    m_walkerState.digStack.pop();
-
     dirent *dent = nullptr;
-    DIR *srcdir = opendir(path.c_str());
-    if(srcdir == nullptr) //Can't read this directory. Continue
-        return true;
-
-    while((dent = readdir(srcdir)) != nullptr)
+    while(!q.done() && (dent = readdir(srcdir)) != nullptr)
     {
-#ifdef DIRMAN_HAS_FSSTATAT
-        struct stat st;
-#endif
-        if(strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0)
+        const char *name = dent->d_name;
+        if(isDotName(name))
             continue;
 
-#ifdef DIRMAN_HAS_FSSTATAT
-        if(fstatat(dirfd(srcdir), dent->d_name, &st, 0) < 0)
-            continue;
+        bool isDir = dent->d_type == DT_DIR;
+        bool isFile = dent->d_type == DT_REG;
+        bool isLink = dent->d_type == DT_LNK;
 
-        if(S_ISDIR(st.st_mode))
-            m_walkerState.digStack.push(path + "/" + dent->d_name);
-        else if(S_ISREG(st.st_mode))
+        if(dent->d_type == DT_UNKNOWN || isLink)
         {
-            if(matchSuffixFilters(dent->d_name, m_walkerState.suffix_filters))
-                list.emplace_back(dent->d_name);
-        }
+            struct stat st;
+#ifdef DIRMAN_HAS_FSSTATAT
+            if(!isLink && fstatat(dirfd(srcdir), name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+                isLink = S_ISLNK(st.st_mode);
+            // Like getListOfFiles(), links are classified by their targets
+            if(fstatat(dirfd(srcdir), name, &st, 0) < 0)
+                continue;
 #else
-        if(dent->d_type == DT_DIR)
-            m_walkerState.digStack.push(path + "/" + dent->d_name);
-        else if(dent->d_type == DT_REG)
+            size_t mark = path.push(name);
+            if(!isLink && ::lstat(path.c_str(), &st) == 0)
+                isLink = S_ISLNK(st.st_mode);
+            int err = ::stat(path.c_str(), &st);
+            path.pop(mark);
+            if(err < 0)
+                continue;
+#endif
+            isDir = S_ISDIR(st.st_mode);
+            isFile = S_ISREG(st.st_mode);
+        }
+
+        if((q.folders ? isDir : isFile) && q.filter(name))
+            q.count++;
+
+        if(isDir && !isLink && q.recursive && !q.done())
         {
-            if(matchSuffixFilters(dent->d_name, m_walkerState.suffix_filters))
-                list.emplace_back(dent->d_name);
+            size_t mark = path.push(name);
+            countDirEntries(path, q);
+            path.pop(mark);
         }
-#endif
     }
 
     closedir(srcdir);
-    curPath = path;
-
     return true;
 }
 
-bool DirMan::exists(const std::string &dirPath)
+bool DirMan::DirMan_private::countEntries(DirManCountQuery &query)
 {
-    PUT_THREAD_GUARD();
-
 #ifdef PGE_USE_ARCHIVES
-    if(Archives::has_prefix(dirPath))
-        return Archives::exists(dirPath.c_str()) == Archives::PATH_DIR;
-#endif // PGE_USE_ARCHIVES
-
-    DIR *dir = opendir(dirPath.c_str());
-    if(dir)
+    if(Archives::has_prefix(m_dirPath))
     {
-        closedir(dir);
+        if(Archives::exists(m_dirPath.c_str()) != Archives::PATH_DIR)
+            return false;
+        countArchiveEntries(m_dirPath, query);
         return true;
     }
-    else
-        return false;
-}
-
-bool DirMan::mkAbsDir(const std::string &dirPath)
-{
-    PUT_THREAD_GUARD();
-
-#ifdef PGE_USE_ARCHIVES
-    if(Archives::has_prefix(dirPath))
-        return false;
 #endif // PGE_USE_ARCHIVES
 
-    return ::mkdir(dirPath.c_str(), S_IRWXU | S_IRWXG) == 0;
+    DirManPathBuilder path(m_dirPath);
+    return countDirEntries(path, query);
 }
 
-bool DirMan::rmAbsDir(const std::string &dirPath)
+bool DirMan::DirMan_private::getListPage(DirManListPage &page)
 {
-    PUT_THREAD_GUARD();
-
 #ifdef PGE_USE_ARCHIVES
-    if(Archives::has_prefix(dirPath))
+    if(Archives::has_prefix(m_dirPath))
+    {
+        // Archives are listed at once, the position is an index in the listing
+        auto entries = Archives::list_dir(m_dirPath.c_str());
+        size_t i = static_cast<size_t>(page.position);
+        for(; i < entries.size() && !page.full(); ++i)
+        {
+            if(entries[i].type != (page.folders ? Archives::PATH_DIR : Archives::PATH_FILE))
+                continue;
+
+            if(page.filter(entries[i].name))
+                page.list.push_back(std::move(entries[i].name));
+        }
+
+        page.position = i;
+        page.done = i >= entries.size();
+        return true;
+    }
+#endif // PGE_USE_ARCHIVES
+
+#ifdef DIRMAN_HAS_GETDENTS64
+    int fd = ::open(m_dirPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+
+    DirManDirReader reader(fd);
+    if(page.position != 0 && !reader.seek(page.position))
+    {
+        ::close(fd);
+        return false;
+    }
+
+    const char *name;
+    unsigned char type;
+
+    while(!page.full())
+    {
+        if(!reader.next(name, type))
+        {
+            page.done = true;
+            break;
+        }
+
+        if(isListedEntry(fd, name, type, page.folders) && page.filter(name))
+            page.list.emplace_back(name);
+    }
+
+    // Position of the entry after the last read one
+    if(!page.done)
+        page.position = reader.offset();
+
+    ::close(fd);
+#else
+    // Positions of telldir() are valid only for the stream which returned them,
+    // so the position is the count of read entries, and they are skipped
+    DIR *srcdir = opendir(m_dirPath.c_str());
+    if(srcdir == nullptr)
+        return false;
+
+#   ifdef DIRMAN_HAS_FSSTATAT
+    const int fd = dirfd(srcdir);
+#   else
+    const int fd = -1;
+#   endif
+
+    dirent *dent = nullptr;
+    uint64_t read = 0;
+    int dots = 0;
+
+    while(!page.full())
+    {
+        dent = readdir(srcdir);
+        if(dent == nullptr)
+        {
+            page.done = true;
+            break;
+        }
+
+        if(read++ < page.position)
+            continue;
+
+        if(dots < 2 && isDotName(dent->d_name))
+        {
+            dots++;
+            continue;
+        }
+
+        if(isListedEntry(fd, dent->d_name, dent->d_type, page.folders) && page.filter(dent->d_name))
+            page.list.emplace_back(dent->d_name);
+    }
+
+    if(!page.done)
+        page.position = read;
+
+    closedir(srcdir);
+#endif
+
+    return true;
+}
+
+bool DirMan::DirMan_private::fetchListFromWalker(std::string &curPath, std::vector<std::string> &list)
+{
+    PUT_THREAD_GUARD();
+    return readWalkerDir(curPath, list);
+}
+
+void DirMan::DirMan_private::fetchBatchFromWalker(WalkerBatch &batch)
+{
+    PUT_THREAD_GUARD();
+
+    while(!batch.full())
+    {
+        WalkerResult &r = batch.next();
+        if(!readWalkerDir(r.path, r.files))
+            break;
+        batch.commit();
+    }
+}
+
+bool DirMan::DirMan_private::readWalkerDir(std::string &curPath, std::vector<std::string> &list)
+{
+#ifdef PGE_USE_ARCHIVES
+    // unsupported for now
+    if(Archives::has_prefix(m_dirPath))
+        return false;
+#endif // PGE_USE_ARCHIVES
+
+    DirWalkerState::Entry e;
+    if(!m_walkerState.popDir(e))
+        return false;
+
+    list.clear();
+
+    const std::string &ignoreFile = m_walkerState.options.ignoreFileName;
+    const bool follow = m_walkerState.options.followSymlinks;
+    const bool needIds = m_walkerState.needsIds();
+    bool hasIgnoreFile = false;
+    m_walkerState.subDirs.clear();
+
+    dirent *dent = nullptr;
+    DIR *srcdir = opendir(e.path.c_str());
+    if(srcdir == nullptr) //Can't read this directory. Continue
+        return true;
+
+    // Paths of entries which can't be accessed relatively to the directory
+    DirManPathBuilder subPath(e.path);
+
+    if(needIds && e.depth == 0)
+    {
+        struct stat st;
+        if(fstat(dirfd(srcdir), &st) == 0)
+            m_walkerState.enterRoot(e, st.st_dev, st.st_ino);
+    }
+
+    int dots = 0;
+    while((dent = readdir(srcdir)) != nullptr)
+    {
+        struct stat st;
+        if(dots < 2 && isDotName(dent->d_name))
+        {
+            dots++;
+            continue;
+        }
+
+#ifdef DIRMAN_HAS_FSSTATAT
+        // Symbolic links are followed here: it's known whether the target is a directory
+        if(fstatat(dirfd(srcdir), dent->d_name, &st, 0) < 0)
+            continue;
+
+        if(S_ISDIR(st.st_mode))
+        {
+            bool isLink = (dent->d_type == DT_LNK);
+            if(!follow && dent->d_type == DT_UNKNOWN)
+            {
+                struct stat lst;
+                isLink = fstatat(dirfd(srcdir), dent->d_name, &lst, AT_SYMLINK_NOFOLLOW) == 0 && S_ISLNK(lst.st_mode);
+            }
+            m_walkerState.addSubDir(dent->d_name, st.st_dev, st.st_ino, isLink);
+        }
+        else if(S_ISREG(st.st_mode))
+#else
+        if(dent->d_type == DT_DIR || (follow && dent->d_type == DT_LNK))
+        {
+            if(needIds)
+            {
+                // Device and inode numbers are needed to enter every directory once and to find mount points
+                size_t mark = subPath.push(dent->d_name);
+                int err = ::stat(subPath.c_str(), &st);
+                subPath.pop(mark);
+                if(err < 0)
+                    continue;
+                if(S_ISDIR(st.st_mode))
+                    m_walkerState.addSubDir(dent->d_name, st.st_dev, st.st_ino, dent->d_type == DT_LNK);
+            }
+            else
+                m_walkerState.addSubDir(dent->d_name);
+        }
+        else if(dent->d_type == DT_REG)
+#endif
+        {
+            if(!ignoreFile.empty() && ignoreFile == dent->d_name)
+                hasIgnoreFile = true;
+            if(matchSuffixFilters(dent->d_name, m_walkerState.suffix_filters))
+                list.emplace_back(dent->d_name);
+        }
+    }
+
+    closedir(srcdir);
+
+    if(hasIgnoreFile)
+    {
+        subPath.push(ignoreFile);
+        FILE *f = fopen(subPath.c_str(), "r");
+        if(f)
+        {
+            e.rules = IgnoreRules::parse(f, e.depth, e.rules);
+            fclose(f);
+        }
+    }
+
+    m_walkerState.finishDir(e, e.path, list);
+    curPath = e.path;
+
+    return true;
+}
+
+struct DuStat
+{
+    bool        isDir = false;
+    uint64_t    size = 0;
+    uint64_t    blocks = 0;
+    uint64_t    nlink = 0;
+    uint64_t    dev = 0;
+    uint64_t    ino = 0;
+};
+
+static bool duStatAt(DIR *dir, const char *name, const std::string &path, DuStat &out)
+{
+#if defined(DIRMAN_HAS_STATX)
+    (void)path;
+    struct statx stx;
+    const unsigned mask = STATX_TYPE | STATX_SIZE | STATX_BLOCKS | STATX_NLINK | STATX_INO;
+    if(statx(dirfd(dir), name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask, &stx) < 0)
+        return false;
+    out.isDir = S_ISDIR(stx.stx_mode);
+    out.size = stx.stx_size;
+    out.blocks = stx.stx_blocks;
+    out.nlink = stx.stx_nlink;
+    out.dev = (static_cast<uint64_t>(stx.stx_dev_major) << 32) | stx.stx_dev_minor;
+    out.ino = stx.stx_ino;
+#else
+    struct stat st;
+#   if defined(DIRMAN_HAS_FSSTATAT)
+    (void)path;
+    if(fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) < 0)
+        return false;
+#   else
+    (void)dir;
+    DirManPathBuilder entryPath(path);
+    entryPath.push(name);
+    if(lstat(entryPath.c_str(), &st) < 0)
+        return false;
+#   endif
+    out.isDir = S_ISDIR(st.st_mode);
+    out.size = static_cast<uint64_t>(st.st_size);
+    out.blocks = static_cast<uint64_t>(st.st_blocks);
+    out.nlink = static_cast<uint64_t>(st.st_nlink);
+    out.dev = static_cast<uint64_t>(st.st_dev);
+    out.ino = static_cast<uint64_t>(st.st_ino);
+#endif
+    return true;
+}
+
+struct DuInodeHash
+{
+    size_t operator()(const std::pair<uint64_t, uint64_t> &k) const
+    {
+        return std::hash<uint64_t>()(k.second ^ (k.first * 0x9E3779B97F4A7C15ULL));
+    }
+};
+
+bool DirMan::DirMan_private::diskUsage(DiskUsage &out, unsigned threads)
+{
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(m_dirPath))
         return false;
 #endif // PGE_USE_ARCHIVES
 
-    return ::rmdir(dirPath.c_str()) == 0;
+    struct Job
+    {
+        size_t      node;
+        std::string path;
+    };
+
+    struct stat rootSt;
+    if(::stat(m_dirPath.c_str(), &rootSt) < 0 || !S_ISDIR(rootSt.st_mode))
+        return false;
+
+    // One node per directory: the memory is proportional to the count of directories
+    std::deque<DiskUsageNode> nodes;
+    // Only files having multiple links are remembered
+    std::unordered_set<std::pair<uint64_t, uint64_t>, DuInodeHash> seenLinks;
+    DirManMutex nodesMutex;
+    DirManWorkQueue<Job> queue;
+
+    nodes.push_back({0, m_dirPath, static_cast<uint64_t>(rootSt.st_blocks) * 512, 0, 0});
+    queue.push({0, m_dirPath});
+
+    DirManWorkQueue<Job>::run(threads, [&]()
+    {
+        Job job;
+        DuStat st;
+
+        while(queue.pop(job))
+        {
+            DIR *srcdir = opendir(job.path.c_str());
+            if(srcdir == nullptr) // Can't read this directory. Continue
+            {
+                queue.done();
+                continue;
+            }
+
+            uint64_t bytes = 0, apparentBytes = 0, files = 0;
+            dirent *dent = nullptr;
+
+            while((dent = readdir(srcdir)) != nullptr)
+            {
+                if(isDotName(dent->d_name))
+                    continue;
+
+                if(!duStatAt(srcdir, dent->d_name, job.path, st))
+                    continue;
+
+                if(st.isDir)
+                {
+                    size_t idx;
+                    {
+                        DirManMutexLocker lock(nodesMutex);
+                        nodes.push_back({job.node, dent->d_name, st.blocks * 512, 0, 0});
+                        idx = nodes.size() - 1;
+                    }
+                    queue.push({idx, job.path + "/" + dent->d_name});
+                    continue;
+                }
+
+                if(st.nlink > 1)
+                {
+                    DirManMutexLocker lock(nodesMutex);
+                    if(!seenLinks.insert(std::make_pair(st.dev, st.ino)).second)
+                        continue; // Already counted
+                }
+
+                bytes += st.blocks * 512;
+                apparentBytes += st.size;
+                files++;
+            }
+
+            closedir(srcdir);
+
+            {
+                DirManMutexLocker lock(nodesMutex);
+                DiskUsageNode &n = nodes[job.node];
+                n.bytes += bytes;
+                n.apparentBytes += apparentBytes;
+                n.files += files;
+            }
+
+            queue.done();
+        }
+    });
+
+    buildDiskUsage(nodes, out);
+
+    return true;
+}
+
+static inline int64_t statMTime(const struct stat &st)
+{
+#if defined(__APPLE__)
+    return static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_mtime) * 1000000000;
+#endif
+}
+
+static inline int64_t statCTime(const struct stat &st)
+{
+#if defined(__APPLE__)
+    return static_cast<int64_t>(st.st_ctimespec.tv_sec) * 1000000000 + st.st_ctimespec.tv_nsec;
+#elif defined(__linux__)
+    return static_cast<int64_t>(st.st_ctim.tv_sec) * 1000000000 + st.st_ctim.tv_nsec;
+#else
+    return static_cast<int64_t>(st.st_ctime) * 1000000000;
+#endif
 }
 
-bool DirMan::mkAbsPath(const std::string &dirPath)
+bool DirMan::DirMan_private::fingerprintFile(FileFingerprint &fp, const FileFingerprint *prev, std::vector<unsigned char> &buffer)
+{
+    struct stat st;
+    if(::stat(fp.path.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+        return false;
+
+    fp.size = static_cast<uint64_t>(st.st_size);
+    fp.mtime = statMTime(st);
+    fp.inode = static_cast<uint64_t>(st.st_ino);
+
+    if(reuseFingerprint(fp, prev))
+        return true;
+
+    int fd = ::open(fp.path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    if(buffer.empty())
+        buffer.resize(1024 * 1024);
+
+    DirManHash64 hash;
+    ssize_t got;
+
+    while((got = ::read(fd, buffer.data(), buffer.size())) != 0)
+    {
+        if(got < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            ::close(fd);
+            return false;
+        }
+
+        hash.update(buffer.data(), static_cast<size_t>(got));
+    }
+
+    ::close(fd);
+    fp.hash = hash.digest();
+    fp.reused = false;
+
+    return true;
+}
+
+#ifdef DIRMAN_HAS_STATFS_MAGIC
+struct FsMagicName
+{
+    unsigned long magic;
+    const char *name;
+};
+
+// Linux reports file system types as magic numbers only
+static const FsMagicName s_fsMagicNames[] =
+{
+    {0xEF53UL,      "ext4"},
+    {0x58465342UL,  "xfs"},
+    {0x9123683EUL,  "btrfs"},
+    {0x2FC12FC1UL,  "zfs"},
+    {0xF2F52010UL,  "f2fs"},
+    {0x01021994UL,  "tmpfs"},
+    {0x858458F6UL,  "ramfs"},
+    {0x794C7630UL,  "overlay"},
+    {0x73717368UL,  "squashfs"},
+    {0x9660UL,      "iso9660"},
+    {0x15013346UL,  "udf"},
+    {0x4D44UL,      "vfat"},
+    {0x2011BAB0UL,  "exfat"},
+    {0x5346544EUL,  "ntfs"},
+    {0x9FA0UL,      "proc"},
+    {0x62656572UL,  "sysfs"},
+    {0x1CD1UL,      "devpts"},
+    {0x64626720UL,  "debugfs"},
+    {0x74726163UL,  "tracefs"},
+    {0x73636673UL,  "securityfs"},
+    {0x27E0EBUL,    "cgroup"},
+    {0x63677270UL,  "cgroup2"},
+    {0x6165676CUL,  "pstore"},
+    {0xCAFE4A11UL,  "bpf"},
+    {0x19800202UL,  "mqueue"},
+    {0x958458F6UL,  "hugetlbfs"},
+    {0x62656570UL,  "configfs"},
+    {0x42494E4DUL,  "binfmt_misc"},
+    {0x0187UL,      "autofs"},
+    {0x65735546UL,  "fuse"},
+    {0x6969UL,      "nfs"},
+    {0x517BUL,      "smb"},
+    {0xFF534D42UL,  "cifs"},
+    {0xFE534D42UL,  "smb2"},
+    {0x01021997UL,  "9p"},
+    {0x00C36400UL,  "ceph"},
+    {0x5346414FUL,  "afs"},
+};
+#endif
+
+std::string DirMan::DirMan_private::fileSystemType(const std::string &path)
+{
+#if defined(DIRMAN_HAS_STATFS_MAGIC)
+    struct statfs st;
+    if(statfs(path.c_str(), &st) < 0)
+        return std::string();
+
+    const unsigned long magic = static_cast<unsigned long>(st.f_type) & 0xFFFFFFFFUL;
+    for(const FsMagicName &m : s_fsMagicNames)
+    {
+        if(m.magic == magic)
+            return m.name;
+    }
+
+    // Unknown type: report the magic number
+    char buf[24];
+    snprintf(buf, sizeof(buf), "0x%lx", magic);
+    return buf;
+#elif defined(DIRMAN_HAS_STATFS_TYPENAME)
+    struct statfs st;
+    if(statfs(path.c_str(), &st) < 0)
+        return std::string();
+    return st.f_fstypename;
+#else
+    (void)path;
+    return std::string();
+#endif
+}
+
+bool DirMan::DirMan_private::exists(const char *dirPath)
+{
+    PUT_THREAD_GUARD();
+
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(dirPath))
+        return Archives::exists(dirPath) == Archives::PATH_DIR;
+#endif // PGE_USE_ARCHIVES
+
+    DIR *dir = opendir(dirPath);
+    if(dir)
+    {
+        closedir(dir);
+        return true;
+    }
+    else
+        return false;
+}
+
+bool DirMan::DirMan_private::mkAbsDir(const char *dirPath)
 {
     PUT_THREAD_GUARD();
 
@@ -343,13 +1195,36 @@ bool DirMan::mkAbsPath(const std::string &dirPath)
         return false;
 #endif // PGE_USE_ARCHIVES
 
-    char tmp[PATH_MAX + 1];
-    char *p = nullptr;
-    size_t len;
+    return ::mkdir(dirPath, S_IRWXU | S_IRWXG) == 0;
+}
+
+bool DirMan::DirMan_private::rmAbsDir(const char *dirPath)
+{
+    PUT_THREAD_GUARD();
+
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(dirPath))
+        return false;
+#endif // PGE_USE_ARCHIVES
+
+    return ::rmdir(dirPath) == 0;
+}
+
+bool DirMan::DirMan_private::mkAbsPath(const char *dirPath)
+{
+    PUT_THREAD_GUARD();
+
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(dirPath))
+        return false;
+#endif // PGE_USE_ARCHIVES
+
+    DirManPathBuilder path;
+    size_t len = strlen(dirPath);
+    path.assign(dirPath, len);
 
-    memset(tmp, 0, sizeof(tmp));
-    snprintf(tmp, PATH_MAX, "%s", dirPath.c_str());
-    len = strlen(tmp);
+    char *tmp = path.data();
+    char *p = nullptr;
 
     if(len > 0 && tmp[len - 1] == '/')
         tmp[len - 1] = 0;
@@ -378,7 +1253,104 @@ bool DirMan::mkAbsPath(const std::string &dirPath)
     return ::mkdir(tmp, S_IRWXU | S_IRWXG) == 0;
 }
 
-bool DirMan::rmAbsPath(const std::string &dirPath)
+bool DirMan::DirMan_private::mkTree(const char *base, const std::vector<DirManMkNode> &nodes, size_t begin, size_t end)
+{
+    // Only calls safe for concurrent use are made: no global lock, so sub-trees may be created in parallel
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(base))
+        return false;
+#endif // PGE_USE_ARCHIVES
+
+    bool ok = true;
+    size_t baseDepth = nodes[begin].depth;
+
+#ifdef DIRMAN_HAS_FSSTATAT
+    // Opened directories along the current branch, the base is the first
+    std::vector<int> parents;
+    int fd = ::open(base, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(fd < 0)
+        return false;
+    parents.push_back(fd);
+
+    for(size_t i = begin; i < end; )
+    {
+        const DirManMkNode &n = nodes[i];
+        const char *name = n.name.c_str();
+
+        while(parents.size() > n.depth - baseDepth + 1)
+        {
+            ::close(parents.back());
+            parents.pop_back();
+        }
+
+        int parent = parents.back();
+        bool made = ::mkdirat(parent, name, S_IRWXU | S_IRWXG) == 0;
+
+        if(!made && errno == EEXIST)
+        {
+            struct stat st;
+            made = ::fstatat(parent, name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        // Only parents of the next directories are kept open
+        if(made && n.end > i + 1 && i + 1 < end)
+        {
+            fd = ::openat(parent, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if(fd >= 0)
+                parents.push_back(fd);
+            else
+                made = false;
+        }
+
+        if(!made)
+        {
+            ok = false;
+            i = n.end; // Skip the sub-tree
+            continue;
+        }
+
+        ++i;
+    }
+
+    for(int p : parents)
+        ::close(p);
+#else
+    DirManPathBuilder path;
+    path.assign(base, strlen(base));
+    // Marks of the parent paths along the current branch
+    std::vector<size_t> parents(1, path.size());
+
+    for(size_t i = begin; i < end; )
+    {
+        const DirManMkNode &n = nodes[i];
+        parents.resize(n.depth - baseDepth + 1);
+        path.pop(parents.back());
+        path.push(n.name);
+
+        bool made = ::mkdir(path.c_str(), S_IRWXU | S_IRWXG) == 0;
+
+        if(!made && errno == EEXIST)
+        {
+            struct stat st;
+            made = ::stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        }
+
+        if(!made)
+        {
+            ok = false;
+            i = n.end; // Skip the sub-tree
+            continue;
+        }
+
+        parents.push_back(path.size());
+        ++i;
+    }
+#endif
+
+    return ok;
+}
+
+bool DirMan::DirMan_private::rmAbsPath(const char *dirPath, DirManTaskControl *control)
 {
     PUT_THREAD_GUARD();
 
@@ -388,75 +1360,219 @@ bool DirMan::rmAbsPath(const std::string &dirPath)
 #endif // PGE_USE_ARCHIVES
 
     int ret = 0;
-    struct DirStackEntry
-    {
-        std::string path;
-        DIR         *d;
-        struct dirent *p;
-    };
-
-    std::stack<DirStackEntry> dirStack;
-    dirStack.push({dirPath, nullptr, nullptr});
+    // The path of the current directory, its parents are found by removing the last component
+    DirManPathBuilder path;
+    path.assign(dirPath, strlen(dirPath));
+    size_t depth = 0;
 
-    while(!dirStack.empty())
+    while(true)
     {
-        DirStackEntry *e = &dirStack.top();
-        e->d = opendir(e->path.c_str());
+        DIR *d = opendir(path.c_str());
+        struct dirent *p;
 
-        bool walkUp = false;
-        if(e->d)
+        bool walkDown = false;
+        bool cancelled = false;
+        if(d)
         {
-            while((e->p = readdir(e->d)) != nullptr)
+            while((p = readdir(d)) != nullptr)
             {
 #ifdef DIRMAN_HAS_FSSTATAT
                 struct stat st = {};
 #endif
-                if(strcmp(e->p->d_name, ".") == 0 || strcmp(e->p->d_name, "..") == 0)
+                if(isDotName(p->d_name))
                     continue;
 
 #ifdef DIRMAN_HAS_FSSTATAT
-                if(fstatat(dirfd(e->d), e->p->d_name, &st, 0) < 0)
-                    continue;
-#else
-                if(e->p->d_type == DT_UNKNOWN)
+                if(fstatat(dirfd(d), p->d_name, &st, 0) < 0)
                     continue;
-#endif
 
-                std::string path = e->path + "/" + e->p->d_name;
-
-#ifdef DIRMAN_HAS_FSSTATAT
                 if(S_ISDIR(st.st_mode))
 #else
-                if(e->p->d_type == DT_DIR)
+                if(p->d_type == DT_UNKNOWN)
+                    continue;
+
+                if(p->d_type == DT_DIR)
 #endif
                 {
-                    closedir(e->d);
-                    e->d = nullptr;
-                    dirStack.push({path, nullptr, nullptr});
-                    walkUp = true;
+                    // Descend, the directory gets read again after the sub-directory is removed
+                    path.push(p->d_name);
+                    depth++;
+                    walkDown = true;
                     break;
                 }
                 else
                 {
+#ifdef DIRMAN_HAS_FSSTATAT
+                    if(::unlinkat(dirfd(d), p->d_name, 0) != 0)
+                        ret = -1;
+#else
+                    size_t mark = path.push(p->d_name);
                     if(::unlink(path.c_str()) != 0)
                         ret = -1;
+                    path.pop(mark);
+#endif
+                    if(control && !control->step())
+                    {
+                        cancelled = true;
+                        break;
+                    }
                 }
             }
+
+            closedir(d);
         }
 
-        if(!walkUp)
+        if(cancelled)
+            return false;
+
+        if(walkDown)
+            continue;
+
+        if(::rmdir(path.c_str()) != 0)
         {
-            if(e->d)
-                closedir(e->d);
-            e->d = nullptr;
-            if(::rmdir(e->path.c_str()) != 0)
-                ret = -1;
-            e = nullptr;
-            dirStack.pop();
+            // Give up: the parent would find this directory again and again
+            ret = -1;
+            break;
         }
+
+        if(control && !control->step())
+            return false;
+
+        if(depth == 0)
+            break;
+
+        path.pop();
+        depth--;
     }
 
     return (ret == 0);
 }
 
+
+
+static void posixStat(DirManBackend::Stat &st, const struct stat &s)
+{
+    st.type = S_ISREG(s.st_mode) ? DirManBackend::ENTRY_FILE :
+              (S_ISDIR(s.st_mode) ? DirManBackend::ENTRY_DIR : DirManBackend::ENTRY_OTHER);
+    st.size = static_cast<uint64_t>(s.st_size);
+    st.mtime = statMTime(s);
+    st.ctime = statCTime(s);
+    st.device = static_cast<uint64_t>(s.st_dev);
+    st.inode = static_cast<uint64_t>(s.st_ino);
+}
+
+DirManBackend::DirHandle DirManNativeBackend::openDir(const std::string &path)
+{
+    return opendir(path.c_str());
+}
+
+bool DirManNativeBackend::readDir(DirHandle dir, Entry &entry)
+{
+    dirent *dent = nullptr;
+
+    while((dent = readdir(static_cast<DIR*>(dir))) != nullptr)
+    {
+        if(isDotName(dent->d_name))
+            continue;
+
+        entry.name = dent->d_name;
+#ifdef DT_UNKNOWN
+        switch(dent->d_type)
+        {
+        case DT_REG:
+            entry.type = ENTRY_FILE;
+            break;
+        case DT_DIR:
+            entry.type = ENTRY_DIR;
+            break;
+        case DT_UNKNOWN:
+        case DT_LNK: // Must be followed
+            entry.type = ENTRY_UNKNOWN;
+            break;
+        default:
+            entry.type = ENTRY_OTHER;
+            break;
+        }
+#else
+        entry.type = ENTRY_UNKNOWN;
+#endif
+        return true;
+    }
+
+    return false;
+}
+
+void DirManNativeBackend::closeDir(DirHandle dir)
+{
+    closedir(static_cast<DIR*>(dir));
+}
+
+bool DirManNativeBackend::stat(const std::string &path, Stat &st)
+{
+    struct stat s;
+    if(::stat(path.c_str(), &s) < 0)
+        return false;
+
+    posixStat(st, s);
+
+    return true;
+}
+
+bool DirManNativeBackend::statEntry(DirHandle dir, const std::string &dirPath, const Entry &entry, Stat &st)
+{
+#ifdef DIRMAN_HAS_FSSTATAT
+    struct stat s;
+    (void)dirPath;
+    if(fstatat(dirfd(static_cast<DIR*>(dir)), entry.name.c_str(), &s, 0) < 0)
+        return false;
+
+    posixStat(st, s);
+
+    return true;
+#else
+    return DirManBackend::statEntry(dir, dirPath, entry, st);
+#endif
+}
+
+bool DirManNativeBackend::mkdir(const std::string &path)
+{
+    return ::mkdir(path.c_str(), S_IRWXU | S_IRWXG) == 0;
+}
+
+bool DirManNativeBackend::rmdir(const std::string &path)
+{
+    return ::rmdir(path.c_str()) == 0;
+}
+
+bool DirManNativeBackend::unlink(const std::string &path)
+{
+    return ::unlink(path.c_str()) == 0;
+}
+
+bool DirManNativeBackend::readFile(const std::string &path, std::string &data)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    char buf[4096];
+    ssize_t got;
+    data.clear();
+
+    while((got = ::read(fd, buf, sizeof(buf))) != 0)
+    {
+        if(got < 0)
+        {
+            if(errno == EINTR)
+                continue;
+            ::close(fd);
+            return false;
+        }
+        data.append(buf, static_cast<size_t>(got));
+    }
+
+    ::close(fd);
+    return true;
+}
+
 #endif
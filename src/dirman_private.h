@@ -27,10 +27,16 @@
 
 #include <string>
 #include <stack>
+#include <deque>
 #include <vector>
+#include <memory>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../include/DirManager/dirman.h"
+#include "../include/DirManager/dirman_backend.h"
+#include "dirman_workqueue.h"
 
 #ifdef _WIN32
 typedef std::wstring    PathString;
@@ -91,25 +97,771 @@ static inline void delEnd(std::basic_string<CHAR> &dirPath, CHAR ch)
     }
 }
 
+//! The name is "." or ".."
+template<class CHAR>
+static inline bool isDotName(const CHAR *name)
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/**
+ * @brief Compact open-addressing hash set of (device, inode) pairs
+ */
+class DirManInodeSet
+{
+    struct Slot
+    {
+        uint64_t dev;
+        uint64_t ino;
+    };
+
+    static constexpr uint64_t EMPTY = ~static_cast<uint64_t>(0);
+    std::vector<Slot>   m_slots;
+    size_t              m_count = 0;
+
+    static inline size_t slotOf(uint64_t dev, uint64_t ino, size_t mask)
+    {
+        uint64_t h = (ino ^ (dev << 32) ^ (dev >> 32)) * 0x9E3779B97F4A7C15ULL;
+        return static_cast<size_t>(h ^ (h >> 29)) & mask;
+    }
+
+    void grow()
+    {
+        std::vector<Slot> old;
+        old.swap(m_slots);
+        m_slots.assign(old.empty() ? 64 : old.size() * 2, Slot{EMPTY, EMPTY});
+
+        const size_t mask = m_slots.size() - 1;
+        for(const Slot &s : old)
+        {
+            if(s.dev == EMPTY && s.ino == EMPTY)
+                continue;
+            size_t i = slotOf(s.dev, s.ino, mask);
+            while(m_slots[i].dev != EMPTY || m_slots[i].ino != EMPTY)
+                i = (i + 1) & mask;
+            m_slots[i] = s;
+        }
+    }
+
+public:
+    void clear()
+    {
+        m_slots.clear();
+        m_count = 0;
+    }
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+    template<class Func>
+    void forEach(Func f) const
+    {
+        for(const Slot &s : m_slots)
+        {
+            if(s.dev != EMPTY || s.ino != EMPTY)
+                f(s.dev, s.ino);
+        }
+    }
+
+    /**
+     * @brief Insert the pair
+     * @return false if the pair is already in the set
+     */
+    bool insert(uint64_t dev, uint64_t ino)
+    {
+        if((m_count + 1) * 2 > m_slots.size())
+            grow();
+
+        const size_t mask = m_slots.size() - 1;
+        size_t i = slotOf(dev, ino, mask);
+
+        while(m_slots[i].dev != EMPTY || m_slots[i].ino != EMPTY)
+        {
+            if(m_slots[i].dev == dev && m_slots[i].ino == ino)
+                return false;
+            i = (i + 1) & mask;
+        }
+
+        m_slots[i].dev = dev;
+        m_slots[i].ino = ino;
+        m_count++;
+
+        return true;
+    }
+};
+
+/**
+ * @brief Directories entered through links or at mount points, shared by halves of a split walk
+ */
+class DirManVisitedSet
+{
+    mutable DirManMutex m_mutex;
+    DirManInodeSet      m_set;
+
+public:
+    void clear()
+    {
+        DirManMutexLocker lock(m_mutex);
+        m_set.clear();
+    }
+
+    /**
+     * @brief Insert the pair
+     * @return false if the directory has been entered already by this walk or by another half of it
+     */
+    bool insert(uint64_t dev, uint64_t ino)
+    {
+        DirManMutexLocker lock(m_mutex);
+        return m_set.insert(dev, ino);
+    }
+
+    //! Call the function with the set locked
+    template<class Func>
+    void read(Func f) const
+    {
+        DirManMutexLocker lock(m_mutex);
+        f(m_set);
+    }
+};
+
+/**
+ * @brief Arena of directory paths stored as (parent node, name) pairs
+ *
+ * Nodes are reference counted by their users and by child nodes, so a name
+ * is kept only while something below it is still in use. Names of all nodes
+ * share one buffer, full paths are built on request.
+ */
+class DirManPathTree
+{
+public:
+    static constexpr uint32_t NONE = ~static_cast<uint32_t>(0);
+
+private:
+    struct Node
+    {
+        uint32_t    parent;
+        uint32_t    refs;
+        uint32_t    length;
+        size_t      offset;
+    };
+
+    std::vector<Node>       m_nodes;
+    std::vector<uint32_t>   m_free;
+    //! Names of all nodes one after another
+    PathString              m_names;
+    //! Size of names of removed nodes in the buffer
+    size_t                  m_garbage = 0;
+    //! Reusable buffer of node chains
+    mutable std::vector<uint32_t> m_chain;
+
+    void compact()
+    {
+        PathString names;
+        names.reserve(m_names.size() - m_garbage);
+        for(Node &n : m_nodes)
+        {
+            if(n.refs == 0)
+                continue;
+            size_t offset = names.size();
+            names.append(m_names, n.offset, n.length);
+            n.offset = offset;
+        }
+        m_names.swap(names);
+        m_garbage = 0;
+    }
+
+public:
+    void clear()
+    {
+        m_nodes.clear();
+        m_free.clear();
+        m_names.clear();
+        m_garbage = 0;
+    }
+
+    //! Count of nodes in use
+    size_t size() const
+    {
+        return m_nodes.size() - m_free.size();
+    }
+
+    /**
+     * @brief Add a node which has one reference owned by the caller
+     * @param parent Parent node, NONE for a root, it gets referenced by the new node
+     * @param name Name of the directory, or the full path of a root
+     * @param length Length of the name
+     */
+    uint32_t add(uint32_t parent, const PathString::value_type *name, size_t length)
+    {
+        uint32_t id;
+        if(!m_free.empty())
+        {
+            id = m_free.back();
+            m_free.pop_back();
+        }
+        else
+        {
+            id = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.emplace_back();
+        }
+
+        Node &n = m_nodes[id];
+        n.parent = parent;
+        n.refs = 1;
+        n.length = static_cast<uint32_t>(length);
+        n.offset = m_names.size();
+        m_names.append(name, length);
+
+        if(parent != NONE)
+            m_nodes[parent].refs++;
+
+        return id;
+    }
+
+    void retain(uint32_t id)
+    {
+        m_nodes[id].refs++;
+    }
+
+    //! Drop one reference, nodes without references release their parents
+    void release(uint32_t id)
+    {
+        while(id != NONE && --m_nodes[id].refs == 0)
+        {
+            const Node &n = m_nodes[id];
+            m_garbage += n.length;
+            m_free.push_back(id);
+            id = n.parent;
+        }
+
+        if(m_free.size() == m_nodes.size())
+            clear();
+        else if(m_garbage > 4096 && m_garbage * 2 > m_names.size())
+            compact();
+    }
+
+    uint32_t parent(uint32_t id) const
+    {
+        return m_nodes[id].parent;
+    }
+
+    PathString name(uint32_t id) const
+    {
+        const Node &n = m_nodes[id];
+        return m_names.substr(n.offset, n.length);
+    }
+
+    //! Build the full path of the node
+    void path(uint32_t id, PathString &out) const
+    {
+        m_chain.clear();
+        for(; id != NONE; id = m_nodes[id].parent)
+            m_chain.push_back(id);
+
+        out.clear();
+        for(auto it = m_chain.rbegin(); it != m_chain.rend(); ++it)
+        {
+            if(it != m_chain.rbegin())
+                out.push_back('/');
+            const Node &n = m_nodes[*it];
+            out.append(m_names, n.offset, n.length);
+        }
+    }
+};
+
+/**
+ * @brief Filter of listed names: run-time suffix filters or compile-time ones
+ */
+struct DirManNameFilter
+{
+    bool        (*func)(const void *context, const char *name, size_t length);
+    const void  *context;
+
+    DirManNameFilter(bool (*f)(const void *, const char *, size_t), const void *ctx) :
+        func(f), context(ctx)
+    {}
+
+    explicit DirManNameFilter(const std::vector<std::string> &suffixFilters) :
+        func(&matchList), context(&suffixFilters)
+    {}
+
+    bool operator()(const char *name) const
+    {
+        return func(context, name, strlen(name));
+    }
+
+    //! Every name passes: there are no run-time filters
+    bool acceptsAll() const
+    {
+        return func == &matchList && static_cast<const std::vector<std::string>*>(context)->empty();
+    }
+
+    bool operator()(const std::string &name) const
+    {
+        return func(context, name.data(), name.size());
+    }
+
+private:
+    static bool matchList(const void *context, const char *name, size_t length)
+    {
+        return DirMan::matchSuffixFilters(name, length, *static_cast<const std::vector<std::string>*>(context));
+    }
+};
+
+/**
+ * @brief Query of countFiles(), countFolders() and containsAny()
+ */
+struct DirManCountQuery
+{
+    const DirManNameFilter &filter;
+    //! Count directories instead of files
+    bool    folders;
+    //! Look into sub-directories too, links to directories are not entered
+    bool    recursive;
+    //! Stop once this count has been reached, 0 to count everything
+    size_t  limit;
+    size_t  count;
+
+    DirManCountQuery(const DirManNameFilter &f, bool countFolders, bool rec, size_t lim) :
+        filter(f), folders(countFolders), recursive(rec), limit(lim), count(0)
+    {}
+
+    bool done() const
+    {
+        return limit > 0 && count >= limit;
+    }
+};
+
+/**
+ * @brief Page of getPageOfFiles() and getPageOfFolders()
+ */
+struct DirManListPage
+{
+    const DirManNameFilter &filter;
+    std::vector<std::string> &list;
+    //! Position in the directory stream, updated to the entry after the page
+    uint64_t &position;
+    //! Set when the end of the directory has been reached
+    bool    &done;
+    bool    folders;
+    size_t  pageSize;
+
+    DirManListPage(const DirManNameFilter &f, std::vector<std::string> &l, uint64_t &pos, bool &end,
+                   bool listFolders, size_t size) :
+        filter(f), list(l), position(pos), done(end), folders(listFolders), pageSize(size)
+    {}
+
+    bool full() const
+    {
+        return list.size() >= pageSize;
+    }
+};
+
+/**
+ * @brief Directory of the mkpathMany() tree, nodes are stored in pre-order
+ */
+struct DirManMkNode
+{
+    //! Name of the directory inside its parent
+    std::string name;
+    //! Depth below the root directory, 1 for its direct children
+    size_t      depth = 0;
+    //! Index past the last node of the sub-tree
+    size_t      end = 0;
+};
+
 class DirMan::DirMan_private
 {
     friend class DirMan;
+    friend class DirManAsync;
 
     std::string     m_dirPath;
 #ifdef _WIN32
     std::wstring    m_dirPathW;
 #endif
 
+    /**
+     * @brief Rules loaded from a single per-directory ignore file
+     */
+    struct IgnoreRules
+    {
+        struct Rule
+        {
+            std::string pattern;
+            bool negate = false;
+            bool dirOnly = false;
+            bool anchored = false;
+        };
+
+        std::vector<Rule>   rules;
+        //! Depth of the directory which contains the rule file
+        size_t              depth = 0;
+        //! Rules inherited from parent directories
+        std::shared_ptr<const IgnoreRules> parent;
+
+        static std::shared_ptr<const IgnoreRules> parse(const std::string &text, size_t depth,
+                                                        const std::shared_ptr<const IgnoreRules> &parent);
+        static std::shared_ptr<const IgnoreRules> parse(FILE *f, size_t depth,
+                                                        const std::shared_ptr<const IgnoreRules> &parent);
+        static bool isIgnored(const IgnoreRules *rules, const std::string &name, bool isDir, size_t depth);
+    };
+
     struct DirWalkerState
     {
-        std::stack<PathString>      digStack;
+        //! Directory taken from the pending ones to be read
+        struct Entry
+        {
+            PathString  path;
+            size_t      depth = 0;
+            //! Device of the directory, known when device numbers are collected
+            uint64_t    device = 0;
+            std::shared_ptr<const IgnoreRules> rules;
+            //! Node of the path, parent of sub-directories
+            uint32_t    node = DirManPathTree::NONE;
+        };
+
+        //! Directory waiting to be read, the path is kept in the tree
+        struct Pending
+        {
+            uint32_t    node;
+            uint32_t    depth;
+            uint64_t    device;
+            std::shared_ptr<const IgnoreRules> rules;
+        };
+
+        //! Directory which has been read but not returned yet
+        typedef WalkerResult ReadyDir;
+
+        //! Pending directories: used as a stack for depth-first walk and as a queue for breadth-first
+        std::deque<Pending>         digStack;
+        //! Paths of pending directories and of the directory being read
+        DirManPathTree              paths;
+        //! Node of the directory returned by the last popDir()
+        uint32_t                    current = DirManPathTree::NONE;
+        //! Directories read ahead, they are returned before the pending ones
+        std::deque<ReadyDir>        ready;
         std::vector<std::string>    suffix_filters;
+        WalkerOptions               options;
+        //! Backend of the walk, taken by beginWalking(): the walk is not affected by setBackend()
+        std::shared_ptr<DirManBackend> backend;
+        struct SubDir
+        {
+            std::string name;
+            uint64_t    dev = 0;
+            uint64_t    ino = 0;
+            bool        isLink = false;
+        };
+
+        //! Reusable buffer of sub-directories of the directory being read
+        std::vector<SubDir>         subDirs;
+        /*!
+         * Directories entered through symbolic links or on another device than their parent, and the root.
+         * Every loop passes through a link, so the set stays small and is enough to break loops.
+         */
+        std::shared_ptr<DirManVisitedSet> visited;
+        //! Device of the root directory
+        uint64_t                    rootDevice = 0;
+        //! Already checked devices of file systems met at mount points, and whether they are skipped
+        std::vector<std::pair<uint64_t, bool> > skippedDevices;
+        //! Count of directories read since the walk has been started
+        size_t                      dirsFetched = 0;
+        //! Count of files returned since the walk has been started
+        size_t                      entriesFetched = 0;
+        //! The walk has been stopped because of the budget exhaustion
+        bool                        stopped = false;
+        //! Length of the root path, to get paths relative to the root
+        size_t                      rootLength = 0;
+
+        void reset();
+        /**
+         * @brief Move about a half of pending directories into another state
+         * @param out Empty state to fill, receives settings and a share of the remaining budget
+         * @return false if there are less than two pending directories
+         */
+        bool split(DirWalkerState &out);
+
+        //! There are enough pending directories to be shared by split()
+        bool canSplit() const
+        {
+            return !stopped && digStack.size() >= 2;
+        }
+
+        //! Serialize the walk, paths of pending directories are saved relatively to the root
+        bool save(std::string &out, const std::string &root, const PathString &rootPath) const;
+        bool load(const std::string &in, std::string &root);
+        bool popDir(Entry &e);
+        bool canEnter(size_t depth) const;
+        void pushRoot(const PathString &path);
+        void pushDir(const Entry &parent, const std::string &name, uint64_t device);
+        //! Drop all pending directories
+        void clearPending();
+        void applyEntriesBudget(std::vector<std::string> &list);
+
+        //! Device and inode numbers of sub-directories are required by the options
+        bool needsIds() const
+        {
+            return options.followSymlinks || options.oneFileSystem || !options.skipFileSystems.empty();
+        }
+
+        //! Remember identifiers of the root directory
+        void enterRoot(Entry &e, uint64_t dev, uint64_t ino);
+        bool isSkippedFileSystem(uint64_t dev, const std::string &path);
+
+        bool hasPruneRules() const
+        {
+            return !options.pruneNames.empty() || !options.pruneGlobs.empty() || options.pruneCallback;
+        }
+
+        bool isSharded() const
+        {
+            return options.shardCount > 1;
+        }
+
+        //! The directory, or its sub-directory if the name is given, belongs to the shard of this walk
+        bool ownsShard(const std::string &dirPath, const std::string *name = nullptr) const;
+
+        bool isPrunedDir(const std::string &parentPath, const std::string &name, const Entry &parent) const;
+        void filterIgnoredFiles(std::vector<std::string> &list, const Entry &parent) const;
+
+        /**
+         * @brief Apply rules to the read directory and queue its sub-directories
+         * @param e The directory which has been read
+         * @param curPath Path to the directory
+         * @param list Files of the directory, filtered in place
+         *
+         * Expects sub-directories in the subDirs buffer. Their device and inode
+         * numbers are required when needsIds() is true.
+         */
+        void finishDir(Entry &e, const std::string &curPath, std::vector<std::string> &list);
+
+        void addSubDir(const char *name, uint64_t dev = 0, uint64_t ino = 0, bool isLink = false)
+        {
+            subDirs.emplace_back();
+            SubDir &s = subDirs.back();
+            s.name = name;
+            s.dev = dev;
+            s.ino = ino;
+            s.isLink = isLink;
+        }
     } m_walkerState;
 
+#ifdef DIRMAN_HAS_STD_THREADS
+    //! Background reading of the walker's directories
+    struct WalkerPrefetch
+    {
+        std::thread             thread;
+        //! Held by the reading thread while the walker state changes
+        std::mutex              stateMutex;
+        //! Protects the queue of read directories (m_walkerState.ready)
+        std::mutex              queueMutex;
+        std::condition_variable cond;
+        size_t                  limit = 0;
+        bool                    quit = false;
+        bool                    done = false;
+    };
+
+    std::unique_ptr<WalkerPrefetch> m_prefetch;
+#endif
+
+    //! Read the next pending directory of the walk through its backend
+    bool readNextDir(std::string &curPath, std::vector<std::string> &list);
+    //! Return the next directory: read ahead, or read now
+    bool walkerFetch(std::string &curPath, std::vector<std::string> &list);
+
+    //! Results of fetchBatchFromWalker() being filled
+    struct WalkerBatch
+    {
+        std::vector<WalkerResult>  *results = nullptr;
+        size_t count = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+        size_t maxEntries = 0;
+        size_t maxBytes = 0;
+
+        //! At least one directory has been added and a limit is reached
+        bool full() const
+        {
+            return count > 0 &&
+                   ((maxEntries > 0 && entries >= maxEntries) ||
+                    (maxBytes > 0 && bytes >= maxBytes));
+        }
+
+        //! Slot for the next directory, memory of previous calls is reused
+        WalkerResult &next()
+        {
+            if(count == results->size())
+                results->emplace_back();
+            return (*results)[count];
+        }
+
+        //! Account the directory placed into the slot returned by next()
+        void commit()
+        {
+            const WalkerResult &r = (*results)[count++];
+            entries += 1 + r.files.size();
+            bytes += r.path.size();
+            for(const std::string &f : r.files)
+                bytes += f.size();
+        }
+    };
+
+    //! Fill the batch: read ahead directories first, then the pending ones
+    void walkerFetchBatch(WalkerBatch &batch);
+    void startPrefetch();
+    void stopPrefetch();
+
+    /*
+     * Native implementation of the platform (dirman_posix.cpp, dirman_winapi.cpp, etc.)
+     */
     void setPath(const std::string &dirPath);
-    bool getListOfFiles(std::vector<std::string> &list, const std::vector<std::string> &suffix_filters);
-    bool getListOfFolders(std::vector<std::string> &list, const std::vector<std::string> &suffix_filters);
+    static void clearPathCache();
+    bool getListOfFiles(std::vector<std::string> &list, const DirManNameFilter &filter);
+    bool getListOfFolders(std::vector<std::string> &list, const DirManNameFilter &filter);
+    //! Count matching entries of this directory, false if it can't be read
+    bool countEntries(DirManCountQuery &query);
+    //! Read matching entries of this directory from the position up to the end of the page
+    bool getListPage(DirManListPage &page);
     bool fetchListFromWalker(std::string &curPath, std::vector<std::string> &list);
+    //! Read the next directory of the walk, the caller holds the lock
+    bool readWalkerDir(std::string &curPath, std::vector<std::string> &list);
+    //! Read next directories into the batch under a single lock
+    void fetchBatchFromWalker(WalkerBatch &batch);
+    static bool exists(const char *dirPath);
+    static std::string fileSystemType(const std::string &path);
+    static bool mkAbsDir(const char *dirPath);
+    static bool rmAbsDir(const char *dirPath);
+    static bool mkAbsPath(const char *dirPath);
+    //! Remove the directory with all its content, the control is checked after every removed entry
+    static bool rmAbsPath(const char *dirPath, DirManTaskControl *control = nullptr);
+    /**
+     * @brief Create directories of the tree nodes in range, each one by a single call
+     * @param base Path to the existing parent directory of the first node
+     * @param nodes Tree built by buildMkTree()
+     * @param begin First node, nodes of the range are placed below it or next to it
+     * @param end Index past the last node
+     * @return true if all directories of the range exist, sub-trees of failed ones are skipped
+     */
+    static bool mkTree(const char *base, const std::vector<DirManMkNode> &nodes, size_t begin, size_t end);
+    //! Split cleaned paths into the tree of unique directories, false if any path leaves the base directory
+    static bool buildMkTree(const std::vector<std::string> &paths, std::vector<DirManMkNode> &nodes);
+    static PathString toPathString(const std::string &path);
+    static std::string fromPathString(const PathString &path);
+    bool diskUsage(DiskUsage &out, unsigned threads);
+    static bool fingerprintFile(FileFingerprint &fp, const FileFingerprint *prev, std::vector<unsigned char> &buffer);
+
+    //! Directory counted by diskUsage(), without totals of its sub-directories
+    struct DiskUsageNode
+    {
+        size_t      parent;
+        std::string name;
+        uint64_t    bytes;
+        uint64_t    apparentBytes;
+        uint64_t    files;
+    };
+    //! Sum totals of nodes into their parents, sub-directories must have larger indices than their parents
+    static void buildDiskUsage(std::deque<DiskUsageNode> &nodes, DiskUsage &out);
+
+    //! Take the hash of the previous fingerprint if size, time and inode of the file are the same
+    static bool reuseFingerprint(FileFingerprint &fp, const FileFingerprint *prev)
+    {
+        if(!prev || prev->size != fp.size || prev->mtime != fp.mtime || prev->inode != fp.inode)
+            return false;
+
+        fp.hash = prev->hash;
+        fp.reused = true;
+        return true;
+    }
+
+    struct EntryInfo
+    {
+        std::string name;
+        bool        isDir = false;
+        bool        isFile = false;
+        uint64_t    size = 0;
+        //! Modification time in nanoseconds since the Epoch
+        int64_t     mtime = 0;
+        //! Status change time in nanoseconds since the Epoch, 0 where not available
+        int64_t     ctime = 0;
+        //! Inode number, 0 where not available
+        uint64_t    inode = 0;
+    };
+
+    //! Copy details of the backend into the entry, the name is not filled
+    static void setEntryInfo(EntryInfo &info, const DirManBackend::Stat &st);
+
+    //! Settings and counters of a snapshot being taken
+    struct SnapshotScan
+    {
+        //! Start time of the previous snapshot, listings of directories changed later are not reused
+        int64_t previousTaken = 0;
+        //! Check sizes and modification times of files in reused listings
+        bool    statFiles = false;
+        //! Count of directories which have been read
+        size_t  readDirs = 0;
+        //! Reusable buffer of directory entries
+        std::vector<EntryInfo> buffer;
+        //! Backend to read directories from
+        DirManBackend *backend = nullptr;
+    };
+
+    /**
+     * @brief Take a snapshot of the directory
+     * @param path Path to the directory
+     * @param dir Output, its identity and times must be filled by the caller
+     * @param prev The same directory in the previous snapshot, nullptr if unknown
+     * @param scan Settings and counters
+     * @return false if the directory can't be read
+     */
+    static bool snapshotDir(const std::string &path, TreeSnapshot::Dir &dir, const TreeSnapshot::Dir *prev, SnapshotScan &scan);
+    //! Copy identity and times of the directory into the snapshot
+    static void setSnapshotDirInfo(TreeSnapshot::Dir &dir, const EntryInfo &info);
+    //! Snapshot of the tree, the previous root is used to reuse listings of unchanged directories
+    static bool snapshotTree(const std::string &path, TreeSnapshot &out, const TreeSnapshot::Dir *prev, SnapshotScan &scan);
+
+    /*
+     * Generic implementation over the run-time backend (dirman_backend.cpp)
+     */
+    //! Currently installed backend, the caller's reference keeps it alive when it gets replaced
+    static std::shared_ptr<DirManBackend> backend();
+    //! The backend is the default native one: platform code may be called directly
+    static bool isNative(const DirManBackend &b);
+
+    //! Path resolution mode of setPath()
+    static PathResolution s_pathResolution;
+    bool backendGetList(DirManBackend &b, std::vector<std::string> &list,
+                        const DirManNameFilter &filter, bool folders);
+    bool backendCountEntries(DirManBackend &b, DirManCountQuery &query);
+    bool backendGetListPage(DirManBackend &b, DirManListPage &page);
+    bool backendFetchListFromWalker(DirManBackend &b, std::string &curPath, std::vector<std::string> &list);
+    void backendFetchBatchFromWalker(DirManBackend &b, WalkerBatch &batch);
+    //! Clean the path for the backend, relative paths start at the root of the backend
+    static std::string backendAbsPath(const std::string &path);
+    static bool backendExists(DirManBackend &b, const std::string &dirPath);
+    static bool backendMkAbsPath(DirManBackend &b, const std::string &dirPath);
+    static bool backendMkTree(DirManBackend &b, const std::string &base, const std::vector<DirManMkNode> &nodes, size_t begin, size_t end);
+    static bool backendRmAbsPath(DirManBackend &b, const std::string &dirPath, DirManTaskControl *control = nullptr);
+    bool backendDiskUsage(DirManBackend &b, DiskUsage &out, unsigned threads);
+    static bool backendFingerprintFile(DirManBackend &b, FileFingerprint &fp, const FileFingerprint *prev);
+    /**
+     * @brief Read the directory with details of every entry
+     * @param b Backend to read from
+     * @param path Absolute path to the directory
+     * @param out Entries of the directory except "." and ".."
+     * @return false if the directory can't be read
+     */
+    static bool listDirectory(DirManBackend &b, const std::string &path, std::vector<EntryInfo> &out);
+    //! Details of a file or a directory, the name is not filled
+    static bool statPath(DirManBackend &b, const std::string &path, EntryInfo &info);
+    //! Names of the directory entries except "." and ".."
+    static bool listNames(DirManBackend &b, const std::string &path, std::vector<std::string> &names);
+
+    /*
+     * Case-insensitive lookup (dirman.cpp)
+     */
+    static bool resolveCaseInsensitive(const std::string &root, const std::string &relPath, std::string &resolved);
+    static void clearCaseCache();
 
 public:
 #if !defined(PGE_NO_THREADING) && defined(PGE_SDL_MUTEX)
@@ -64,6 +64,21 @@
 static constexpr const SceMode gSceDirMode = 0777;
 
 
+PathString DirMan::DirMan_private::toPathString(const std::string &path)
+{
+    return path;
+}
+
+std::string DirMan::DirMan_private::fromPathString(const PathString &path)
+{
+    return path;
+}
+
+void DirMan::DirMan_private::clearPathCache()
+{
+    // No cache: paths are resolved without touching the file system
+}
+
 void DirMan::DirMan_private::setPath(const std::string &dirPath)
 {
     PUT_THREAD_GUARD();
@@ -100,7 +115,7 @@ static inline int hasEndSlash(char* string)
     return string[strlen(string) - 1] == '/';
 }
 
-bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, const std::vector<std::string> &suffix_filters)
+bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, const DirManNameFilter &filter)
 {
     PUT_THREAD_GUARD();
     list.clear();
@@ -113,7 +128,7 @@ bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, cons
             if(ent.type != Archives::PATH_FILE)
                 continue;
 
-            if(!matchSuffixFilters(ent.name, suffix_filters))
+            if(!filter(ent.name))
                 continue;
 
             list.push_back(std::move(ent.name));
@@ -142,7 +157,7 @@ bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, cons
                 // matching non-directories
                 if(!XTECH_S_DIR(dirEntry.d_stat.st_mode))
                 {
-                    if(matchSuffixFilters(dirEntry.d_name , suffix_filters))
+                    if(filter(dirEntry.d_name))
                             list.push_back(dirEntry.d_name);
                 }
 
@@ -160,7 +175,7 @@ static inline int quick_stat_folders(
     char* m_dirPath,
     char* path,
     std::vector<std::string>& list,
-    const std::vector<std::string>& suffix_filters)
+    const DirManNameFilter &filter)
 {
     SceUID dfd = sceIoDopen(path);
     int _added = -1;
@@ -182,7 +197,7 @@ static inline int quick_stat_folders(
 
                 if (XTECH_S_DIR(dirEntry.d_stat.st_mode))
                 {
-                    if(DirMan::matchSuffixFilters(dirEntry.d_name , suffix_filters))
+                    if(filter(dirEntry.d_name))
                     {
                         pLogDebug("(quick_stat) Directory match! `%s`", dirEntry.d_name);
                         list.push_back(dirEntry.d_name);
@@ -198,7 +213,7 @@ static inline int quick_stat_folders(
     return _added;
 }
 
-bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string>& list, const std::vector<std::string>& suffix_filters)
+bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string> &list, const DirManNameFilter &filter)
 {
     PUT_THREAD_GUARD();
     list.clear();
@@ -211,7 +226,7 @@ bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string>& list, co
             if(ent.type != Archives::PATH_DIR)
                 continue;
 
-            if(!matchSuffixFilters(ent.name, suffix_filters))
+            if(!filter(ent.name))
                 continue;
 
             list.push_back(std::move(ent.name));
@@ -238,7 +253,7 @@ bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string>& list, co
 
                 if (XTECH_S_DIR(dirEntry.d_stat.st_mode))
                 {
-                    if(matchSuffixFilters(dirEntry.d_name , suffix_filters))
+                    if(filter(dirEntry.d_name))
                     {
                         list.push_back(dirEntry.d_name);
                     }
@@ -292,77 +307,265 @@ bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string>& list, co
     return true;
 }
 
+#ifdef PGE_USE_ARCHIVES
+static void countArchiveEntries(const std::string &path, DirManCountQuery &q)
+{
+    for(auto& ent : Archives::list_dir(path.c_str()))
+    {
+        if(q.done())
+            return;
+
+        bool isDir = ent.type == Archives::PATH_DIR;
+        if((q.folders ? isDir : ent.type == Archives::PATH_FILE) && q.filter(ent.name))
+            q.count++;
+
+        if(isDir && q.recursive)
+            countArchiveEntries(path + "/" + ent.name, q);
+    }
+}
+#endif // PGE_USE_ARCHIVES
+
+static bool countDirEntries(const std::string &path, DirManCountQuery &q)
+{
+    SceUID dfd = sceIoDopen(path.c_str());
+    if(dfd < 0)
+        return false;
+
+    int res = 0;
+    do
+    {
+        SceIoDirent dirEntry;
+        memset(&dirEntry, 0, sizeof(SceIoDirent));
+
+        res = sceIoDread(dfd, &dirEntry);
+        if(res > 0)
+        {
+            if(isDotName(dirEntry.d_name))
+                continue;
+
+            bool isDir = XTECH_S_DIR(dirEntry.d_stat.st_mode);
+            if(q.folders == isDir && q.filter(dirEntry.d_name))
+                q.count++;
+
+            if(isDir && q.recursive && !q.done())
+                countDirEntries(path + "/" + dirEntry.d_name, q);
+        }
+    } while(res > 0 && !q.done());
+
+    sceIoDclose(dfd);
+
+    return true;
+}
+
+bool DirMan::DirMan_private::countEntries(DirManCountQuery &query)
+{
+    PUT_THREAD_GUARD();
+
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(m_dirPath))
+    {
+        if(Archives::exists(m_dirPath.c_str()) != Archives::PATH_DIR)
+            return false;
+        countArchiveEntries(m_dirPath, query);
+        return true;
+    }
+#endif // PGE_USE_ARCHIVES
+
+    return countDirEntries(m_dirPath, query);
+}
+
+bool DirMan::DirMan_private::getListPage(DirManListPage &page)
+{
+    PUT_THREAD_GUARD();
+
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(m_dirPath))
+    {
+        // Archives are listed at once, the position is an index in the listing
+        auto entries = Archives::list_dir(m_dirPath.c_str());
+        size_t i = static_cast<size_t>(page.position);
+        for(; i < entries.size() && !page.full(); ++i)
+        {
+            if(entries[i].type != (page.folders ? Archives::PATH_DIR : Archives::PATH_FILE))
+                continue;
+
+            if(page.filter(entries[i].name))
+                page.list.push_back(std::move(entries[i].name));
+        }
+
+        page.position = i;
+        page.done = i >= entries.size();
+        return true;
+    }
+#endif // PGE_USE_ARCHIVES
+
+    SceUID dfd = sceIoDopen(m_dirPath.c_str());
+    if(dfd < 0)
+        return false;
+
+    // Directory streams can't be seeked: skip entries of previous pages
+    uint64_t read = 0;
+    int res = 1;
+    while(!page.full())
+    {
+        SceIoDirent dirEntry;
+        memset(&dirEntry, 0, sizeof(SceIoDirent));
+
+        res = sceIoDread(dfd, &dirEntry);
+        if(res <= 0)
+            break;
+
+        if(read++ < page.position)
+            continue;
+
+        if(isDotName(dirEntry.d_name))
+            continue;
+
+        if((XTECH_S_DIR(dirEntry.d_stat.st_mode) != 0) == page.folders && page.filter(dirEntry.d_name))
+            page.list.push_back(dirEntry.d_name);
+    }
+
+    sceIoDclose(dfd);
+
+    page.position = read;
+    page.done = res <= 0;
+
+    return true;
+}
+
 bool DirMan::DirMan_private::fetchListFromWalker(std::string &curPath, std::vector<std::string> &list)
 {
     PUT_THREAD_GUARD();
+    return readWalkerDir(curPath, list);
+}
 
+void DirMan::DirMan_private::fetchBatchFromWalker(WalkerBatch &batch)
+{
+    PUT_THREAD_GUARD();
+
+    while(!batch.full())
+    {
+        WalkerResult &r = batch.next();
+        if(!readWalkerDir(r.path, r.files))
+            break;
+        batch.commit();
+    }
+}
+
+bool DirMan::DirMan_private::readWalkerDir(std::string &curPath, std::vector<std::string> &list)
+{
 #ifdef PGE_USE_ARCHIVES
     // unsupported for now
     if(Archives::has_prefix(m_dirPath))
         return false;
 #endif // PGE_USE_ARCHIVES
 
-    (void)list;
-    pLogWarning("[dirman_vitafs] ::fetchListFromWalker called. CurPath: %s", curPath.c_str());
+    DirWalkerState::Entry e;
+    if(!m_walkerState.popDir(e))
+        return false;
 
+    list.clear();
 
-    // if(m_walkerState.digStack.empty())
-    //     return false;
+    const std::string &ignoreFile = m_walkerState.options.ignoreFileName;
+    bool hasIgnoreFile = false;
+    m_walkerState.subDirs.clear();
 
-    // list.clear();
+    SceUID dfd = sceIoDopen(e.path.c_str());
+    if(dfd < 0) //Can't read this directory. Continue
+        return true;
 
-    // std::string path = m_walkerState.digStack.top();
-    // m_walkerState.digStack.pop();
+    // There are no symbolic links and no inode numbers: every directory is entered once anyway
+    if(m_walkerState.needsIds() && e.depth == 0)
+        m_walkerState.enterRoot(e, 0, 0);
 
-    // dirent *dent = NULL;
-    // DIR *srcdir = opendir(path.c_str());
-    // if(srcdir == NULL) //Can't read this directory. Continue
-    //     return true;
+    int res = 0;
+    do
+    {
+        SceIoDirent dirEntry;
+        memset(&dirEntry, 0, sizeof(SceIoDirent));
 
-    // while((dent = readdir(srcdir)) != NULL)
-    // {
-    //     struct stat st;
-    //     if(strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0)
-    //         continue;
+        res = sceIoDread(dfd, &dirEntry);
+        if(res <= 0)
+            break;
 
-    //     if(fstatat(dirfd(srcdir), dent->d_name, &st, 0) < 0)
-    //         continue;
+        if(isDotName(dirEntry.d_name))
+            continue;
 
-    //     if(S_ISDIR(st.st_mode))
-    //         m_walkerState.digStack.push(path + "/" + dent->d_name);
-    //     else if(S_ISREG(st.st_mode))
-    //     {
-    //         if(matchSuffixFilters(dent->d_name, m_walkerState.suffix_filters))
-    //             list.push_back(dent->d_name);
-    //     }
-    // }
-    // closedir(srcdir);
-    // curPath = path;
+        if(XTECH_S_DIR(dirEntry.d_stat.st_mode))
+            m_walkerState.addSubDir(dirEntry.d_name);
+        else
+        {
+            if(!ignoreFile.empty() && ignoreFile == dirEntry.d_name)
+                hasIgnoreFile = true;
+            if(matchSuffixFilters(dirEntry.d_name, m_walkerState.suffix_filters))
+                list.emplace_back(dirEntry.d_name);
+        }
+    } while(res > 0);
+
+    sceIoDclose(dfd);
+
+    if(hasIgnoreFile)
+    {
+        FILE *f = fopen((e.path + "/" + ignoreFile).c_str(), "r");
+        if(f)
+        {
+            e.rules = IgnoreRules::parse(f, e.depth, e.rules);
+            fclose(f);
+        }
+    }
+
+    m_walkerState.finishDir(e, e.path, list);
+    curPath = e.path;
 
     return true;
 }
 
-bool DirMan::exists(const std::string &dirPath)
+bool DirMan::DirMan_private::diskUsage(DiskUsage &out, unsigned threads)
+{
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(m_dirPath))
+        return false;
+#endif // PGE_USE_ARCHIVES
+
+    // Allocated sizes are not reported: the generic implementation gets the same
+    DirManNativeBackend native;
+    return backendDiskUsage(native, out, threads);
+}
+
+bool DirMan::DirMan_private::fingerprintFile(FileFingerprint &fp, const FileFingerprint *prev, std::vector<unsigned char> &buffer)
+{
+    (void)buffer;
+    DirManNativeBackend native;
+    return backendFingerprintFile(native, fp, prev);
+}
+
+std::string DirMan::DirMan_private::fileSystemType(const std::string &path)
+{
+    (void)path;
+    return std::string();
+}
+
+bool DirMan::DirMan_private::exists(const char *dirPath)
 {
     PUT_THREAD_GUARD();
 
 #ifdef PGE_USE_ARCHIVES
     if(Archives::has_prefix(dirPath))
-        return Archives::exists(dirPath.c_str()) == Archives::PATH_DIR;
+        return Archives::exists(dirPath) == Archives::PATH_DIR;
 #endif // PGE_USE_ARCHIVES
 
 #if !defined(__PSP__)
     SceIoStat _stat;
 #endif
 
-    if(dirPath == "/")
+    if(strcmp(dirPath, "/") == 0)
     {
-        pLogWarning("[dirman_vitafs] WARNING: dirPath was / (dirPath: `%s`)", dirPath.c_str());
+        pLogWarning("[dirman_vitafs] WARNING: dirPath was / (dirPath: `%s`)", dirPath);
         return false;
     }
 
 #if defined(__PSP__)
-    SceUID dfd = sceIoDopen(dirPath.c_str());
+    SceUID dfd = sceIoDopen(dirPath);
     if(dfd >= 0)
     {
         sceIoDclose(dfd);
@@ -370,9 +573,9 @@ bool DirMan::exists(const std::string &dirPath)
     }
     return false;
 #else
-    if(sceIoGetstat(dirPath.c_str(), &_stat) < 0)
+    if(sceIoGetstat(dirPath, &_stat) < 0)
     {
-        pLogWarning("[dirman_vitafs]  File at path %s doesn't exist.", dirPath.c_str());
+        pLogWarning("[dirman_vitafs]  File at path %s doesn't exist.", dirPath);
         return false;
     }
 
@@ -391,7 +594,7 @@ bool DirMan::exists(const std::string &dirPath)
     //     return false;
 }
 
-bool DirMan::mkAbsDir(const std::string &dirPath)
+bool DirMan::DirMan_private::mkAbsDir(const char *dirPath)
 {
     PUT_THREAD_GUARD();
 
@@ -400,10 +603,10 @@ bool DirMan::mkAbsDir(const std::string &dirPath)
         return false;
 #endif // PGE_USE_ARCHIVES
 
-    return (sceIoMkdir(dirPath.c_str(), gSceDirMode) == 0);
+    return (sceIoMkdir(dirPath, gSceDirMode) == 0);
 }
 
-bool DirMan::rmAbsDir(const std::string &dirPath)
+bool DirMan::DirMan_private::rmAbsDir(const char *dirPath)
 {
     PUT_THREAD_GUARD();
 
@@ -412,10 +615,10 @@ bool DirMan::rmAbsDir(const std::string &dirPath)
         return false;
 #endif // PGE_USE_ARCHIVES
 
-    return (sceIoRmdir(dirPath.c_str()) == 0);
+    return (sceIoRmdir(dirPath) == 0);
 }
 
-bool DirMan::mkAbsPath(const std::string &dirPath)
+bool DirMan::DirMan_private::mkAbsPath(const char *dirPath)
 {
     PUT_THREAD_GUARD();
 
@@ -432,7 +635,7 @@ bool DirMan::mkAbsPath(const std::string &dirPath)
     SceIoStat _stat;
 
     memset(tmp, 0, sizeof(tmp));
-    snprintf(tmp, PATH_MAX, "%s", dirPath.c_str());
+    snprintf(tmp, PATH_MAX, "%s", dirPath);
     len = strlen(tmp);
 
     if(len > 0 && tmp[len - 1] == '/')
@@ -472,7 +675,51 @@ bool DirMan::mkAbsPath(const std::string &dirPath)
     return rv;
 }
 
-bool DirMan::rmAbsPath(const std::string &dirPath)
+bool DirMan::DirMan_private::mkTree(const char *base, const std::vector<DirManMkNode> &nodes, size_t begin, size_t end)
+{
+    PUT_THREAD_GUARD();
+
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(base))
+        return false;
+#endif // PGE_USE_ARCHIVES
+
+    bool ok = true;
+    size_t baseDepth = nodes[begin].depth;
+    std::string path = base;
+    // Lengths of the parent paths along the current branch
+    std::vector<size_t> parents(1, path.size());
+    SceIoStat _stat;
+
+    for(size_t i = begin; i < end; )
+    {
+        const DirManMkNode &n = nodes[i];
+        parents.resize(n.depth - baseDepth + 1);
+        path.resize(parents.back());
+        path.push_back('/');
+        path.append(n.name);
+
+        bool made = sceIoMkdir(path.c_str(), gSceDirMode) == 0;
+
+        if(!made)
+            made = sceIoGetstat(path.c_str(), &_stat) >= 0 && XTECH_S_DIR(_stat.st_mode);
+
+        if(!made)
+        {
+            pLogDebug("    mkTree: failed to make `%s`", path.c_str());
+            ok = false;
+            i = n.end; // Skip the sub-tree
+            continue;
+        }
+
+        parents.push_back(path.size());
+        ++i;
+    }
+
+    return ok;
+}
+
+bool DirMan::DirMan_private::rmAbsPath(const char *dirPath, DirManTaskControl *control)
 {
     PUT_THREAD_GUARD();
 
@@ -481,66 +728,120 @@ bool DirMan::rmAbsPath(const std::string &dirPath)
         return false;
 #endif // PGE_USE_ARCHIVES
 
-    pLogWarning("TODO: need to remove abs path for %s", dirPath.c_str());
-    return -1;
+    DirManNativeBackend native;
+    return backendRmAbsPath(native, dirPath, control);
+}
 
 
-    // int ret = 0;
-    // struct DirStackEntry
-    // {
-    //     std::string path;
-    //     DIR         *d;
-    //     struct dirent *p;
-    // };
 
-    // std::stack<DirStackEntry> dirStack;
-    // dirStack.push({dirPath, NULL, NULL});
+//! Directory opened by sceIoDopen(), the entry holds the last returned one
+struct VitaFsDir
+{
+    SceUID      fd;
+    SceIoDirent entry;
+};
 
-    // while(!dirStack.empty())
-    // {
-    //     DirStackEntry *e = &dirStack.top();
-    //     e->d = opendir(e->path.c_str());
+static void vitaFsStat(DirManBackend::Stat &st, const SceIoStat &s)
+{
+    const bool isDir = XTECH_S_DIR(s.st_mode) != 0;
+    st.type = isDir ? DirManBackend::ENTRY_DIR : DirManBackend::ENTRY_FILE;
+    st.size = isDir ? 0 : static_cast<uint64_t>(s.st_size);
+    // Modification time is not reported here: cached listings get read again every time
+    st.mtime = 0;
+    st.ctime = 0;
+    st.device = 0;
+    st.inode = 0;
+}
 
-    //     bool walkUp = false;
-    //     if(e->d)
-    //     {
-    //         while((e->p = readdir(e->d)) != NULL)
-    //         {
-    //             struct stat st;
-    //             if(strcmp(e->p->d_name, ".") == 0 || strcmp(e->p->d_name, "..") == 0)
-    //                 continue;
-
-    //             if(fstatat(dirfd(e->d), e->p->d_name, &st, 0) < 0)
-    //                 continue;
-
-    //             std::string path = e->path + "/" + e->p->d_name;
-
-    //             if(S_ISDIR(st.st_mode))
-    //             {
-    //                 closedir(e->d);
-    //                 dirStack.push({path, NULL, NULL});
-    //                 walkUp = true;
-    //                 break;
-    //             }
-    //             else
-    //             {
-    //                 if(::unlink(path.c_str()) != 0)
-    //                     ret = -1;
-    //             }
-    //         }
-    //     }
+DirManBackend::DirHandle DirManNativeBackend::openDir(const std::string &path)
+{
+    SceUID fd = sceIoDopen(path.c_str());
+    if(fd < 0)
+        return nullptr;
 
-    //     if(!walkUp)
-    //     {
-    //         if(e->d) closedir(e->d);
-    //         if(::rmdir(e->path.c_str()) != 0)
-    //             ret = -1;
-    //         e = NULL;
-    //         dirStack.pop();
-    //     }
-    // }
+    VitaFsDir *d = new VitaFsDir;
+    d->fd = fd;
+    return d;
+}
+
+bool DirManNativeBackend::readDir(DirHandle dir, Entry &entry)
+{
+    VitaFsDir *d = static_cast<VitaFsDir*>(dir);
+
+    for(;;)
+    {
+        memset(&d->entry, 0, sizeof(SceIoDirent));
+        if(sceIoDread(d->fd, &d->entry) <= 0)
+            return false;
+
+        if(isDotName(d->entry.d_name))
+            continue;
+
+        entry.name = d->entry.d_name;
+        entry.type = XTECH_S_DIR(d->entry.d_stat.st_mode) ? ENTRY_DIR : ENTRY_FILE;
+        return true;
+    }
+}
+
+void DirManNativeBackend::closeDir(DirHandle dir)
+{
+    VitaFsDir *d = static_cast<VitaFsDir*>(dir);
+    sceIoDclose(d->fd);
+    delete d;
+}
+
+bool DirManNativeBackend::stat(const std::string &path, Stat &st)
+{
+    SceIoStat s;
+    memset(&s, 0, sizeof(SceIoStat));
+    if(sceIoGetstat(path.c_str(), &s) < 0)
+        return false;
+
+    vitaFsStat(st, s);
+
+    return true;
+}
+
+bool DirManNativeBackend::statEntry(DirHandle dir, const std::string &dirPath, const Entry &entry, Stat &st)
+{
+    (void)dirPath;
+    (void)entry;
+    vitaFsStat(st, static_cast<VitaFsDir*>(dir)->entry.d_stat);
+    return true;
+}
+
+bool DirManNativeBackend::mkdir(const std::string &path)
+{
+    return sceIoMkdir(path.c_str(), gSceDirMode) == 0;
+}
+
+bool DirManNativeBackend::rmdir(const std::string &path)
+{
+    return sceIoRmdir(path.c_str()) == 0;
+}
+
+bool DirManNativeBackend::unlink(const std::string &path)
+{
+    return sceIoRemove(path.c_str()) == 0;
+}
+
+bool DirManNativeBackend::readFile(const std::string &path, std::string &data)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    if(!f)
+        return false;
+
+    char buf[4096];
+    size_t got;
+    data.clear();
+
+    while((got = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.append(buf, got);
+
+    bool ok = ferror(f) == 0;
+    fclose(f);
 
-    // return (ret == 0);
+    return ok;
 }
 
 
@@ -24,6 +24,8 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#include <sys/stat.h>
+#include <stdio.h>
 #include <algorithm>
 
 #ifdef PGE_USE_ARCHIVES
@@ -32,6 +34,7 @@
 
 #include "../include/DirManager/dirman.h"
 #include "dirman_private.h"
+#include "dirman_hash.h"
 
 static std::wstring Str2WStr(const std::string &str)
 {
@@ -51,6 +54,41 @@ static std::string WStr2Str(const std::wstring &wstr)
     return dest;
 }
 
+static bool getDirFileId(const std::wstring &path, uint64_t &dev, uint64_t &ino)
+{
+    HANDLE h = CreateFileW(path.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                           NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if(h == INVALID_HANDLE_VALUE)
+        return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(h, &info);
+    CloseHandle(h);
+
+    if(!ok)
+        return false;
+
+    dev = info.dwVolumeSerialNumber;
+    ino = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+
+    return true;
+}
+
+PathString DirMan::DirMan_private::toPathString(const std::string &path)
+{
+    return Str2WStr(path);
+}
+
+std::string DirMan::DirMan_private::fromPathString(const PathString &path)
+{
+    return WStr2Str(path);
+}
+
+void DirMan::DirMan_private::clearPathCache()
+{
+    // No cache: paths are resolved without touching the file system
+}
+
 void DirMan::DirMan_private::setPath(const std::string &dirPath)
 {
 #ifdef PGE_USE_ARCHIVES
@@ -77,7 +115,7 @@ void DirMan::DirMan_private::setPath(const std::string &dirPath)
     delEnd(m_dirPath, '/');
 }
 
-bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, const std::vector<std::string> &suffix_filters)
+bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, const DirManNameFilter &filter)
 {
     list.clear();
 
@@ -89,7 +127,7 @@ bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, cons
             if(ent.type != Archives::PATH_FILE)
                 continue;
 
-            if(!matchSuffixFilters(ent.name, suffix_filters))
+            if(!filter(ent.name))
                 continue;
 
             list.push_back(std::move(ent.name));
@@ -108,13 +146,13 @@ bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, cons
     {
         if((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
         {
-            if((wcscmp(data.cFileName, L"..") == 0) || (wcscmp(data.cFileName, L".") == 0))
+            if(isDotName(data.cFileName))
                 continue;
         }
         else
         {
             std::string fileName = WStr2Str(data.cFileName);
-            if(matchSuffixFilters(fileName, suffix_filters))
+            if(filter(fileName))
                 list.push_back(fileName);
         }
     }
@@ -124,7 +162,7 @@ bool DirMan::DirMan_private::getListOfFiles(std::vector<std::string> &list, cons
     return true;
 }
 
-bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string> &list, const std::vector<std::string> &suffix_filters)
+bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string> &list, const DirManNameFilter &filter)
 {
     list.clear();
 
@@ -136,7 +174,7 @@ bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string> &list, co
             if(ent.type != Archives::PATH_DIR)
                 continue;
 
-            if(!matchSuffixFilters(ent.name, suffix_filters))
+            if(!filter(ent.name))
                 continue;
 
             list.push_back(std::move(ent.name));
@@ -155,10 +193,10 @@ bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string> &list, co
     {
         if((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
         {
-            if((wcscmp(data.cFileName, L"..") == 0) || (wcscmp(data.cFileName, L".") == 0))
+            if(isDotName(data.cFileName))
                 continue;
             std::string fileName = WStr2Str(data.cFileName);
-            if(matchSuffixFilters(fileName, suffix_filters))
+            if(filter(fileName))
                 list.push_back(fileName);
         }
     }
@@ -168,7 +206,148 @@ bool DirMan::DirMan_private::getListOfFolders(std::vector<std::string> &list, co
     return true;
 }
 
+#ifdef PGE_USE_ARCHIVES
+static void countArchiveEntries(const std::string &path, DirManCountQuery &q)
+{
+    for(auto& ent : Archives::list_dir(path.c_str()))
+    {
+        if(q.done())
+            return;
+
+        bool isDir = ent.type == Archives::PATH_DIR;
+        if((q.folders ? isDir : ent.type == Archives::PATH_FILE) && q.filter(ent.name))
+            q.count++;
+
+        if(isDir && q.recursive)
+            countArchiveEntries(path + "/" + ent.name, q);
+    }
+}
+#endif // PGE_USE_ARCHIVES
+
+static bool countDirEntries(std::wstring &path, DirManCountQuery &q)
+{
+    WIN32_FIND_DATAW data;
+    size_t mark = path.size();
+
+    path.append(L"/*");
+    HANDLE hFind = FindFirstFileW(path.c_str(), &data);
+    path.resize(mark);
+    if(hFind == INVALID_HANDLE_VALUE)
+        return false;
+
+    do
+    {
+        const bool isDir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if(isDir && isDotName(data.cFileName))
+            continue;
+
+        if(q.folders == isDir && q.filter(WStr2Str(data.cFileName)))
+            q.count++;
+
+        // Don't enter junctions and directory links
+        if(isDir && q.recursive && !q.done() && (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+        {
+            path.push_back(L'/');
+            path.append(data.cFileName);
+            countDirEntries(path, q);
+            path.resize(mark);
+        }
+    }
+    while(!q.done() && FindNextFileW(hFind, &data));
+    FindClose(hFind);
+
+    return true;
+}
+
+bool DirMan::DirMan_private::countEntries(DirManCountQuery &query)
+{
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(m_dirPath))
+    {
+        if(Archives::exists(m_dirPath.c_str()) != Archives::PATH_DIR)
+            return false;
+        countArchiveEntries(m_dirPath, query);
+        return true;
+    }
+#endif // PGE_USE_ARCHIVES
+
+    std::wstring path = m_dirPathW;
+    return countDirEntries(path, query);
+}
+
+bool DirMan::DirMan_private::getListPage(DirManListPage &page)
+{
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(m_dirPath))
+    {
+        // Archives are listed at once, the position is an index in the listing
+        auto entries = Archives::list_dir(m_dirPath.c_str());
+        size_t i = static_cast<size_t>(page.position);
+        for(; i < entries.size() && !page.full(); ++i)
+        {
+            if(entries[i].type != (page.folders ? Archives::PATH_DIR : Archives::PATH_FILE))
+                continue;
+
+            if(page.filter(entries[i].name))
+                page.list.push_back(std::move(entries[i].name));
+        }
+
+        page.position = i;
+        page.done = i >= entries.size();
+        return true;
+    }
+#endif // PGE_USE_ARCHIVES
+
+    HANDLE hFind;
+    WIN32_FIND_DATAW data;
+
+    hFind = FindFirstFileW((m_dirPathW + L"/*").c_str(), &data);
+    if(hFind == INVALID_HANDLE_VALUE)
+        return false;
+
+    // Find handles can't be seeked: skip entries of previous pages
+    uint64_t read = 0;
+    bool more = true;
+    for(; more && read < page.position; ++read)
+        more = FindNextFileW(hFind, &data) != FALSE;
+
+    for(; more && !page.full(); ++read)
+    {
+        const bool isDir = (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if(isDir == page.folders && !isDotName(data.cFileName))
+        {
+            std::string fileName = WStr2Str(data.cFileName);
+            if(page.filter(fileName))
+                page.list.push_back(fileName);
+        }
+
+        more = FindNextFileW(hFind, &data) != FALSE;
+    }
+    FindClose(hFind);
+
+    page.position = read;
+    page.done = !more;
+
+    return true;
+}
+
 bool DirMan::DirMan_private::fetchListFromWalker(std::string &curPath, std::vector<std::string> &list)
+{
+    return readWalkerDir(curPath, list);
+}
+
+void DirMan::DirMan_private::fetchBatchFromWalker(WalkerBatch &batch)
+{
+    while(!batch.full())
+    {
+        WalkerResult &r = batch.next();
+        if(!readWalkerDir(r.path, r.files))
+            break;
+        batch.commit();
+    }
+}
+
+bool DirMan::DirMan_private::readWalkerDir(std::string &curPath, std::vector<std::string> &list)
 {
 #ifdef PGE_USE_ARCHIVES
     // unsupported for now
@@ -176,32 +355,49 @@ bool DirMan::DirMan_private::fetchListFromWalker(std::string &curPath, std::vect
         return false;
 #endif // PGE_USE_ARCHIVES
 
-    if(m_walkerState.digStack.empty())
+    DirWalkerState::Entry e;
+    if(!m_walkerState.popDir(e))
         return false;
 
     list.clear();
 
-    std::wstring path = m_walkerState.digStack.top();
-    m_walkerState.digStack.pop();
+    const std::string &ignoreFile = m_walkerState.options.ignoreFileName;
+    const bool needIds = m_walkerState.needsIds();
+    bool hasIgnoreFile = false;
+    m_walkerState.subDirs.clear();
 
     HANDLE hFind;
     WIN32_FIND_DATAW data;
+    uint64_t dev, ino;
 
-    hFind = FindFirstFileW((path + L"/*").c_str(), &data);
+    hFind = FindFirstFileW((e.path + L"/*").c_str(), &data);
     if(hFind == INVALID_HANDLE_VALUE)
         return true; //Can't read this directory. Continue
+
+    if(needIds && e.depth == 0 && getDirFileId(e.path, dev, ino))
+        m_walkerState.enterRoot(e, dev, ino);
+
     do
     {
         if((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
         {
-            if((wcscmp(data.cFileName, L"..") == 0) || (wcscmp(data.cFileName, L".") == 0))
+            if(isDotName(data.cFileName))
+                continue;
+
+            bool isLink = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+            dev = 0;
+            ino = 0;
+            // Identifiers are only needed to enter every directory once and to find mount points
+            if(needIds && !getDirFileId(e.path + L"/" + data.cFileName, dev, ino))
                 continue;
 
-            m_walkerState.digStack.push(path + L"/" + data.cFileName);
+            m_walkerState.addSubDir(WStr2Str(data.cFileName).c_str(), dev, ino, isLink);
         }
         else
         {
             std::string fileNameU = WStr2Str(data.cFileName);
+            if(!ignoreFile.empty() && ignoreFile == fileNameU)
+                hasIgnoreFile = true;
             if(matchSuffixFilters(fileNameU, m_walkerState.suffix_filters))
                 list.push_back(fileNameU);
         }
@@ -209,16 +405,152 @@ bool DirMan::DirMan_private::fetchListFromWalker(std::string &curPath, std::vect
     while(FindNextFileW(hFind, &data));
 
     FindClose(hFind);
-    curPath = WStr2Str(path);
+    curPath = WStr2Str(e.path);
+
+    if(hasIgnoreFile)
+    {
+        FILE *f = _wfopen((e.path + L"/" + Str2WStr(ignoreFile)).c_str(), L"r");
+        if(f)
+        {
+            e.rules = IgnoreRules::parse(f, e.depth, e.rules);
+            fclose(f);
+        }
+    }
+
+    m_walkerState.finishDir(e, curPath, list);
+
+    return true;
+}
+
+bool DirMan::DirMan_private::diskUsage(DiskUsage &out, unsigned threads)
+{
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(m_dirPath))
+        return false;
+#endif // PGE_USE_ARCHIVES
+
+    (void)threads; // Sequential only for now
+
+    struct Job
+    {
+        size_t          node;
+        std::wstring    path;
+    };
+
+    DWORD ftyp = GetFileAttributesW(m_dirPathW.c_str());
+    if(ftyp == INVALID_FILE_ATTRIBUTES || (ftyp & FILE_ATTRIBUTE_DIRECTORY) == 0)
+        return false;
+
+    // Allocated size is not reported by the find API, the file size is used instead
+    std::deque<DiskUsageNode> nodes;
+    std::stack<Job> jobs;
+    nodes.push_back({0, m_dirPath, 0, 0, 0});
+    jobs.push({0, m_dirPathW});
+
+    while(!jobs.empty())
+    {
+        Job job = std::move(jobs.top());
+        jobs.pop();
+
+        HANDLE hFind;
+        WIN32_FIND_DATAW data;
+
+        hFind = FindFirstFileW((job.path + L"/*").c_str(), &data);
+        if(hFind == INVALID_HANDLE_VALUE)
+            continue; //Can't read this directory. Continue
+        do
+        {
+            if((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+            {
+                if(isDotName(data.cFileName))
+                    continue;
+                if((data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0)
+                    continue; // Don't follow links
+
+                nodes.push_back({job.node, WStr2Str(data.cFileName), 0, 0, 0});
+                jobs.push({nodes.size() - 1, job.path + L"/" + data.cFileName});
+            }
+            else
+            {
+                uint64_t size = (static_cast<uint64_t>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+                DiskUsageNode &n = nodes[job.node];
+                n.bytes += size;
+                n.apparentBytes += size;
+                n.files++;
+            }
+        }
+        while(FindNextFileW(hFind, &data));
+
+        FindClose(hFind);
+    }
+
+    buildDiskUsage(nodes, out);
 
     return true;
 }
 
-bool DirMan::exists(const std::string &dirPath)
+bool DirMan::DirMan_private::fingerprintFile(FileFingerprint &fp, const FileFingerprint *prev, std::vector<unsigned char> &buffer)
+{
+    std::wstring path = Str2WStr(fp.path);
+    struct _stat64 st;
+    if(_wstat64(path.c_str(), &st) != 0 || (st.st_mode & _S_IFREG) == 0)
+        return false;
+
+    fp.size = static_cast<uint64_t>(st.st_size);
+    fp.mtime = static_cast<int64_t>(st.st_mtime) * 1000000000;
+    fp.inode = 0;
+
+    if(reuseFingerprint(fp, prev))
+        return true;
+
+    FILE *f = _wfopen(path.c_str(), L"rb");
+    if(!f)
+        return false;
+
+    if(buffer.empty())
+        buffer.resize(1024 * 1024);
+
+    DirManHash64 hash;
+    size_t got;
+
+    while((got = fread(buffer.data(), 1, buffer.size(), f)) > 0)
+        hash.update(buffer.data(), got);
+
+    bool ok = ferror(f) == 0;
+    fclose(f);
+
+    fp.hash = hash.digest();
+    fp.reused = false;
+
+    return ok;
+}
+
+static inline int64_t fileTimeToUnixNs(const FILETIME &ft)
+{
+    // FILETIME counts 100-nanosecond intervals since January 1, 1601
+    int64_t t = static_cast<int64_t>((static_cast<uint64_t>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime);
+    return (t - 116444736000000000LL) * 100;
+}
+
+std::string DirMan::DirMan_private::fileSystemType(const std::string &path)
+{
+    wchar_t volume[MAX_PATH + 1];
+    wchar_t fsName[MAX_PATH + 1];
+
+    if(GetVolumePathNameW(Str2WStr(path).c_str(), volume, MAX_PATH + 1) == FALSE)
+        return std::string();
+
+    if(GetVolumeInformationW(volume, NULL, 0, NULL, NULL, NULL, fsName, MAX_PATH + 1) == FALSE)
+        return std::string();
+
+    return WStr2Str(fsName);
+}
+
+bool DirMan::DirMan_private::exists(const char *dirPath)
 {
 #ifdef PGE_USE_ARCHIVES
     if(Archives::has_prefix(dirPath))
-        return Archives::exists(dirPath.c_str()) == Archives::PATH_DIR;
+        return Archives::exists(dirPath) == Archives::PATH_DIR;
 #endif // PGE_USE_ARCHIVES
 
     DWORD ftyp = GetFileAttributesW(Str2WStr(dirPath).c_str());
@@ -229,7 +561,7 @@ bool DirMan::exists(const std::string &dirPath)
     return false;       // this is not a directory!
 }
 
-bool DirMan::mkAbsDir(const std::string &dirPath)
+bool DirMan::DirMan_private::mkAbsDir(const char *dirPath)
 {
 #ifdef PGE_USE_ARCHIVES
     if(Archives::has_prefix(dirPath))
@@ -239,7 +571,7 @@ bool DirMan::mkAbsDir(const std::string &dirPath)
     return (CreateDirectoryW(Str2WStr(dirPath).c_str(), NULL) != FALSE);
 }
 
-bool DirMan::rmAbsDir(const std::string &dirPath)
+bool DirMan::DirMan_private::rmAbsDir(const char *dirPath)
 {
 #ifdef PGE_USE_ARCHIVES
     if(Archives::has_prefix(dirPath))
@@ -249,7 +581,7 @@ bool DirMan::rmAbsDir(const std::string &dirPath)
     return RemoveDirectoryW(Str2WStr(dirPath).c_str()) != FALSE;
 }
 
-bool DirMan::mkAbsPath(const std::string &dirPath)
+bool DirMan::DirMan_private::mkAbsPath(const char *dirPath)
 {
 #ifdef PGE_USE_ARCHIVES
     if(Archives::has_prefix(dirPath))
@@ -277,7 +609,50 @@ bool DirMan::mkAbsPath(const std::string &dirPath)
     return (CreateDirectoryW(tmp, NULL) != FALSE);
 }
 
-bool DirMan::rmAbsPath(const std::string &dirPath)
+bool DirMan::DirMan_private::mkTree(const char *base, const std::vector<DirManMkNode> &nodes, size_t begin, size_t end)
+{
+#ifdef PGE_USE_ARCHIVES
+    if(Archives::has_prefix(base))
+        return false;
+#endif // PGE_USE_ARCHIVES
+
+    bool ok = true;
+    size_t baseDepth = nodes[begin].depth;
+    std::wstring path = Str2WStr(base);
+    // Lengths of the parent paths along the current branch
+    std::vector<size_t> parents(1, path.size());
+
+    for(size_t i = begin; i < end; )
+    {
+        const DirManMkNode &n = nodes[i];
+        parents.resize(n.depth - baseDepth + 1);
+        path.resize(parents.back());
+        path.push_back(L'/');
+        path.append(Str2WStr(n.name));
+
+        bool made = CreateDirectoryW(path.c_str(), NULL) != FALSE;
+
+        if(!made && GetLastError() == ERROR_ALREADY_EXISTS)
+        {
+            DWORD ftyp = GetFileAttributesW(path.c_str());
+            made = ftyp != INVALID_FILE_ATTRIBUTES && (ftyp & FILE_ATTRIBUTE_DIRECTORY);
+        }
+
+        if(!made)
+        {
+            ok = false;
+            i = n.end; // Skip the sub-tree
+            continue;
+        }
+
+        parents.push_back(path.size());
+        ++i;
+    }
+
+    return ok;
+}
+
+bool DirMan::DirMan_private::rmAbsPath(const char *dirPath, DirManTaskControl *control)
 {
 #ifdef PGE_USE_ARCHIVES
     if(Archives::has_prefix(dirPath))
@@ -308,7 +683,7 @@ bool DirMan::rmAbsPath(const std::string &dirPath)
         {
             do
             {
-                if((wcscmp(e->data.cFileName, L"..") == 0) || (wcscmp(e->data.cFileName, L".") == 0))
+                if(isDotName(e->data.cFileName))
                     continue;
                 std::wstring path = e->path + L"/" + e->data.cFileName;
 
@@ -324,6 +699,11 @@ bool DirMan::rmAbsPath(const std::string &dirPath)
                 {
                     if(DeleteFileW(path.c_str()) == FALSE)
                         ret = FALSE;
+                    if(control && !control->step())
+                    {
+                        FindClose(e->hFind);
+                        return false;
+                    }
                 }
             }
             while(FindNextFileW(e->hFind, &e->data));
@@ -336,9 +716,135 @@ bool DirMan::rmAbsPath(const std::string &dirPath)
                 ret = FALSE;
             e = NULL;
             dirStack.pop();
+            if(control && !control->step())
+                return false;
         }
     }
     return (ret == TRUE);
 }
 
+
+
+//! Search opened by FindFirstFileW(), its data hold the last returned entry
+struct WinApiDir
+{
+    HANDLE              find;
+    WIN32_FIND_DATAW    data;
+    //! The first entry has been found by FindFirstFileW() already
+    bool                first;
+};
+
+static void winApiStat(DirManBackend::Stat &st, DWORD attributes, DWORD sizeHigh, DWORD sizeLow, const FILETIME &writeTime)
+{
+    const bool isDir = (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    st.type = isDir ? DirManBackend::ENTRY_DIR : DirManBackend::ENTRY_FILE;
+    st.size = isDir ? 0 : ((static_cast<uint64_t>(sizeHigh) << 32) | sizeLow);
+    st.mtime = fileTimeToUnixNs(writeTime);
+    st.ctime = 0;
+    st.device = 0;
+    st.inode = 0;
+}
+
+DirManBackend::DirHandle DirManNativeBackend::openDir(const std::string &path)
+{
+    WinApiDir *d = new WinApiDir;
+    d->find = FindFirstFileW((Str2WStr(path) + L"/*").c_str(), &d->data);
+    if(d->find == INVALID_HANDLE_VALUE)
+    {
+        delete d;
+        return nullptr;
+    }
+
+    d->first = true;
+    return d;
+}
+
+bool DirManNativeBackend::readDir(DirHandle dir, Entry &entry)
+{
+    WinApiDir *d = static_cast<WinApiDir*>(dir);
+
+    while(d->first || FindNextFileW(d->find, &d->data))
+    {
+        d->first = false;
+        if(isDotName(d->data.cFileName))
+            continue;
+
+        entry.name = WStr2Str(d->data.cFileName);
+        if((d->data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0)
+            entry.type = ENTRY_UNKNOWN; // Must be followed
+        else if((d->data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+            entry.type = ENTRY_DIR;
+        else
+            entry.type = ENTRY_FILE;
+        return true;
+    }
+
+    return false;
+}
+
+void DirManNativeBackend::closeDir(DirHandle dir)
+{
+    WinApiDir *d = static_cast<WinApiDir*>(dir);
+    FindClose(d->find);
+    delete d;
+}
+
+bool DirManNativeBackend::stat(const std::string &path, Stat &st)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if(GetFileAttributesExW(Str2WStr(path).c_str(), GetFileExInfoStandard, &data) == FALSE)
+        return false;
+
+    winApiStat(st, data.dwFileAttributes, data.nFileSizeHigh, data.nFileSizeLow, data.ftLastWriteTime);
+
+    return true;
+}
+
+bool DirManNativeBackend::statEntry(DirHandle dir, const std::string &dirPath, const Entry &entry, Stat &st)
+{
+    const WIN32_FIND_DATAW &data = static_cast<WinApiDir*>(dir)->data;
+
+    // The find data describe links themselves
+    if((data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0)
+        return DirManBackend::statEntry(dir, dirPath, entry, st);
+
+    winApiStat(st, data.dwFileAttributes, data.nFileSizeHigh, data.nFileSizeLow, data.ftLastWriteTime);
+
+    return true;
+}
+
+bool DirManNativeBackend::mkdir(const std::string &path)
+{
+    return CreateDirectoryW(Str2WStr(path).c_str(), NULL) != FALSE;
+}
+
+bool DirManNativeBackend::rmdir(const std::string &path)
+{
+    return RemoveDirectoryW(Str2WStr(path).c_str()) != FALSE;
+}
+
+bool DirManNativeBackend::unlink(const std::string &path)
+{
+    return DeleteFileW(Str2WStr(path).c_str()) != FALSE;
+}
+
+bool DirManNativeBackend::readFile(const std::string &path, std::string &data)
+{
+    FILE *f = _wfopen(Str2WStr(path).c_str(), L"rb");
+    if(!f)
+        return false;
+
+    char buf[4096];
+    size_t got;
+    data.clear();
+
+    while((got = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.append(buf, got);
+
+    bool ok = ferror(f) == 0;
+    fclose(f);
+
+    return ok;
+}
+
 #endif
@@ -0,0 +1,253 @@
+/*
+ * DirMan - A small crossplatform class to manage directories
+ *
+ * Copyright (c) 2017-2026 Vitaliy Novichkov <admin@wohlnet.ru>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef DIRMAN_WORKQUEUE_H
+#define DIRMAN_WORKQUEUE_H
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <functional>
+
+#if !defined(PGE_NO_THREADING) && !defined(PGE_SDL_MUTEX)
+#   define DIRMAN_HAS_STD_THREADS
+#   include <mutex>
+#   include <condition_variable>
+#   include <thread>
+#elif !defined(PGE_NO_THREADING)
+#   include <SDL2/SDL_mutex.h>
+#endif
+
+/**
+ * @brief Mutex of data shared with threads of the caller, does nothing when threading is disabled
+ *
+ * Threads of the library need std::thread, but callers of SDL builds may still use
+ * DirMan from several threads: the SDL mutex is used there.
+ */
+class DirManMutex
+{
+#if defined(DIRMAN_HAS_STD_THREADS)
+    std::mutex m_mutex;
+public:
+    void lock() { m_mutex.lock(); }
+    void unlock() { m_mutex.unlock(); }
+#elif !defined(PGE_NO_THREADING)
+    SDL_mutex *m_mutex;
+public:
+    DirManMutex() : m_mutex(SDL_CreateMutex()) {}
+    ~DirManMutex() { SDL_DestroyMutex(m_mutex); }
+    DirManMutex(const DirManMutex &) = delete;
+    DirManMutex &operator=(const DirManMutex &) = delete;
+    void lock() { SDL_LockMutex(m_mutex); }
+    void unlock() { SDL_UnlockMutex(m_mutex); }
+#else
+public:
+    void lock() {}
+    void unlock() {}
+#endif
+};
+
+class DirManMutexLocker
+{
+    DirManMutex &m_mutex;
+public:
+    explicit DirManMutexLocker(DirManMutex &mutex) : m_mutex(mutex)
+    {
+        m_mutex.lock();
+    }
+
+    ~DirManMutexLocker()
+    {
+        m_mutex.unlock();
+    }
+};
+
+/**
+ * @brief Progress and cancellation of a long operation, shared between the caller and the worker
+ */
+struct DirManTaskControl
+{
+    std::atomic<bool>   cancelled{false};
+    std::atomic<size_t> processed{0};
+    //! Called by the worker after every processed entry
+    std::function<void(size_t processed)> progress;
+
+    //! Account one processed entry, returns false once the operation must stop
+    bool step()
+    {
+        size_t n = ++processed;
+        if(progress)
+            progress(n);
+        return !cancelled.load();
+    }
+};
+
+/**
+ * @brief Queue of jobs shared by a group of workers, where every job may produce more jobs
+ *
+ * Workers take jobs by pop() and must call done() after every processed job.
+ * The pop() returns false once the queue is empty and no other worker is busy,
+ * so the work is complete. Without threading support all jobs are processed
+ * by the calling thread.
+ */
+template<class T>
+class DirManWorkQueue
+{
+    std::deque<T>   m_items;
+    size_t          m_busy = 0;
+    size_t          m_limit = 0;
+    bool            m_abort = false;
+#ifdef DIRMAN_HAS_STD_THREADS
+    std::mutex      m_mutex;
+    std::condition_variable m_cond;
+    //! Signalled when a job is taken from a limited queue
+    std::condition_variable m_space;
+#endif
+
+public:
+    /**
+     * @brief Make push() wait while the queue holds this count of jobs, 0 for unlimited
+     *
+     * Only for producers which don't process jobs themselves, while other threads do.
+     * Without threading support push() never waits.
+     */
+    void setLimit(size_t limit)
+    {
+        m_limit = limit;
+    }
+
+    void push(T &&item)
+    {
+#ifdef DIRMAN_HAS_STD_THREADS
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if(m_limit > 0)
+            m_space.wait(lock, [this]{ return m_abort || m_items.size() < m_limit; });
+#endif
+        m_items.push_back(std::move(item));
+#ifdef DIRMAN_HAS_STD_THREADS
+        m_cond.notify_one();
+#endif
+    }
+
+    bool pop(T &item)
+    {
+#ifdef DIRMAN_HAS_STD_THREADS
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this]{ return m_abort || !m_items.empty() || m_busy == 0; });
+#endif
+        if(m_abort || m_items.empty())
+            return false;
+
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_busy++;
+#ifdef DIRMAN_HAS_STD_THREADS
+        if(m_limit > 0)
+            m_space.notify_one();
+#endif
+        return true;
+    }
+
+    //! Mark the calling thread as busy without taking a job, for example while it produces jobs
+    void acquire()
+    {
+#ifdef DIRMAN_HAS_STD_THREADS
+        std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+        m_busy++;
+    }
+
+    void done()
+    {
+#ifdef DIRMAN_HAS_STD_THREADS
+        std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+        m_busy--;
+#ifdef DIRMAN_HAS_STD_THREADS
+        if(m_busy == 0 && m_items.empty())
+            m_cond.notify_all();
+#endif
+    }
+
+    //! Drop all pending jobs and wake up all workers
+    void abort()
+    {
+#ifdef DIRMAN_HAS_STD_THREADS
+        std::lock_guard<std::mutex> lock(m_mutex);
+#endif
+        m_abort = true;
+        m_items.clear();
+#ifdef DIRMAN_HAS_STD_THREADS
+        m_cond.notify_all();
+        m_space.notify_all();
+#endif
+    }
+
+    //! Count of threads run() starts for the requested count, 1 without threading support
+    static unsigned threadCount(unsigned threads)
+    {
+#ifdef DIRMAN_HAS_STD_THREADS
+        if(threads == 0)
+        {
+            threads = std::thread::hardware_concurrency();
+            if(threads == 0)
+                threads = 1;
+            else if(threads > 8)
+                threads = 8; // More threads won't help on a single storage
+        }
+        return threads;
+#else
+        (void)threads;
+        return 1;
+#endif
+    }
+
+    /**
+     * @brief Run the worker function at the given count of threads and wait for them
+     * @param threads count of threads, 0 to pick automatically
+     * @param worker function to run
+     */
+    template<class Func>
+    static void run(unsigned threads, Func worker)
+    {
+#ifdef DIRMAN_HAS_STD_THREADS
+        threads = threadCount(threads);
+
+        std::vector<std::thread> pool;
+        pool.reserve(threads - 1);
+        for(unsigned i = 1; i < threads; ++i)
+            pool.emplace_back(worker);
+
+        worker();
+
+        for(std::thread &t : pool)
+            t.join();
+#else
+        (void)threads;
+        worker();
+#endif
+    }
+};
+
+#endif // DIRMAN_WORKQUEUE_H
@@ -1,6 +1,62 @@
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#ifndef _WIN32
+#   include <unistd.h>
+#   include <fcntl.h>
+#   include <sys/stat.h>
+#   include <sys/wait.h>
+#endif
 
 #include <DirManager/dirman.h>
+#include <DirManager/dirman_backend.h>
+#include <DirManager/dirman_async.h>
+
+// Count of heap allocations made through operator new
+static std::atomic<size_t> g_allocations(0);
+
+#if defined(__GNUC__)
+// Keep the pairs of malloc() and free() out of callers: GCC warns about them when inlined
+#   define TEST_NOINLINE __attribute__((noinline))
+#else
+#   define TEST_NOINLINE
+#endif
+
+TEST_NOINLINE void *operator new(size_t size)
+{
+    g_allocations++;
+    void *p = std::malloc(size ? size : 1);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+TEST_NOINLINE void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void *p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+#endif
+
+static void writeFile(const std::string &path, const char *data)
+{
+    FILE *f = fopen(path.c_str(), "w");
+    if(f)
+    {
+        fprintf(f, "%s", data);
+        fclose(f);
+    }
+}
 
 int main(int , char *[])
 {
@@ -65,5 +121,1485 @@ int main(int , char *[])
     else
         std::cout << "rmpath FAILED!" << std::endl;
 
+    std::cout << "=============Running test 6 (walker with pruning rules)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        myDir.mkpath(tree + "/src/.git/objects");
+        myDir.mkpath(tree + "/src/node_modules/lib");
+        myDir.mkpath(tree + "/src/old.bak");
+        myDir.mkpath(tree + "/src/sub/skipme");
+        myDir.mkpath(tree + "/src/sub/keep");
+        writeFile(myDir.absolutePath() + "/" + tree + "/src/a.txt", "a");
+        writeFile(myDir.absolutePath() + "/" + tree + "/src/.git/objects/b.txt", "b");
+        writeFile(myDir.absolutePath() + "/" + tree + "/src/node_modules/lib/c.txt", "c");
+        writeFile(myDir.absolutePath() + "/" + tree + "/src/old.bak/d.txt", "d");
+        writeFile(myDir.absolutePath() + "/" + tree + "/src/sub/skipme/e.txt", "e");
+        writeFile(myDir.absolutePath() + "/" + tree + "/src/sub/keep/f.txt", "f");
+        writeFile(myDir.absolutePath() + "/" + tree + "/src/sub/keep/g.tmp", "g");
+        writeFile(myDir.absolutePath() + "/" + tree + "/src/sub/.dirmanignore", "# test rules\nskipme/\n*.tmp\n");
+
+        DirMan treeDir(myDir.absolutePath() + "/" + tree);
+        DirMan::WalkerOptions opts;
+        opts.pruneNames.push_back(".git");
+        opts.pruneNames.push_back("node_modules");
+        opts.pruneGlobs.push_back("*.bak");
+        opts.ignoreFileName = ".dirmanignore";
+
+        size_t found = 0;
+        bool wrong = false;
+        treeDir.beginWalking(opts, {".txt", ".tmp"});
+        while(treeDir.fetchListFromWalker(itPath, files))
+        {
+            for(std::string &file : files)
+            {
+                std::cout << itPath + "/" + file << std::endl;
+                if(file != "a.txt" && file != "f.txt")
+                    wrong = true;
+                found++;
+            }
+        }
+
+        if(found == 2 && !wrong)
+            std::cout << "prune Ok!" << std::endl;
+        else
+            std::cout << "prune FAILED!" << std::endl;
+
+        if(DirMan::matchGlob("Block-1.png", "[Bb]lock-?.*") && !DirMan::matchGlob("block.png", "*.gif"))
+            std::cout << "glob Ok!" << std::endl;
+        else
+            std::cout << "glob FAILED!" << std::endl;
+
+        myDir.rmpath(tree);
+    }
+
+    std::cout << "=============Running test 7 (breadth-first walk with limits)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a/aa");
+        myDir.mkpath(tree + "/b");
+        writeFile(treePath + "/f0.txt", "0");
+        writeFile(treePath + "/a/f1.txt", "1");
+        writeFile(treePath + "/a/aa/f2.txt", "2");
+        writeFile(treePath + "/b/f3.txt", "3");
+
+        DirMan treeDir(treePath);
+        DirMan::WalkerOptions opts;
+        opts.order = DirMan::WalkerOptions::BREADTH_FIRST;
+
+        size_t lastDepth = 0, found = 0;
+        bool ordered = true;
+        treeDir.beginWalking(opts);
+        while(treeDir.fetchListFromWalker(itPath, files))
+        {
+            size_t depth = std::count(itPath.begin(), itPath.end(), '/');
+            if(depth < lastDepth)
+                ordered = false;
+            lastDepth = depth;
+            found += files.size();
+        }
+        std::cout << ((ordered && found == 4) ? "BFS Ok!" : "BFS FAILED!") << std::endl;
+
+        opts.maxDepth = 1;
+        found = 0;
+        treeDir.beginWalking(opts);
+        while(treeDir.fetchListFromWalker(itPath, files))
+            found += files.size();
+        std::cout << ((found == 3) ? "maxDepth Ok!" : "maxDepth FAILED!") << std::endl;
+
+        opts.maxDepth = -1;
+        opts.maxEntries = 2;
+        found = 0;
+        treeDir.beginWalking(opts);
+        while(treeDir.fetchListFromWalker(itPath, files))
+            found += files.size();
+        std::cout << ((found == 2) ? "maxEntries Ok!" : "maxEntries FAILED!") << std::endl;
+
+        opts.maxEntries = 0;
+        opts.maxDirectories = 2;
+        size_t dirs = 0;
+        treeDir.beginWalking(opts);
+        while(treeDir.fetchListFromWalker(itPath, files))
+            dirs++;
+        std::cout << ((dirs == 2) ? "maxDirectories Ok!" : "maxDirectories FAILED!") << std::endl;
+
+        myDir.rmpath(tree);
+    }
+
+    std::cout << "=============Running test 8 (disk usage)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a/aa");
+        myDir.mkpath(tree + "/b");
+        writeFile(treePath + "/f0.txt", "0123456789");
+        writeFile(treePath + "/a/f1.txt", "01234");
+        writeFile(treePath + "/a/aa/f2.txt", "0");
+        writeFile(treePath + "/b/f3.txt", "0123");
+
+        DirMan::DiskUsage du;
+        DirMan treeDir(treePath);
+        bool ok = treeDir.diskUsage(du);
+        std::cout << "Bytes: " << du.bytes << ", apparent: " << du.apparentBytes
+                  << ", files: " << du.files << ", dirs: " << du.dirs << std::endl;
+
+        ok &= du.files == 4 && du.dirs == 3 && du.apparentBytes == 20;
+        ok &= du.children.size() == 2 && du.children[0].name == "a" && du.children[0].apparentBytes == 6;
+        if(ok)
+            std::cout << "diskUsage Ok!" << std::endl;
+        else
+            std::cout << "diskUsage FAILED!" << std::endl;
+
+        myDir.rmpath(tree);
+    }
+
+    std::cout << "=============Running test 9 (content fingerprints)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a");
+        writeFile(treePath + "/f0.txt", "same content");
+        writeFile(treePath + "/a/f1.txt", "same content");
+        writeFile(treePath + "/a/f2.txt", "other content");
+
+        DirMan treeDir(treePath);
+        std::vector<DirMan::FileFingerprint> prints, prints2;
+        std::vector<std::vector<size_t>> dups;
+
+        bool ok = treeDir.fingerprintFiles(prints);
+        DirMan::findDuplicates(prints, dups);
+        ok &= prints.size() == 3 && dups.size() == 1 && dups[0].size() == 2;
+
+        ok &= treeDir.fingerprintFiles(prints2, prints);
+        ok &= prints2.size() == 3;
+        for(size_t i = 0; i < prints2.size() && ok; ++i)
+            ok &= prints2[i].reused && prints2[i].hash == prints[i].hash;
+
+        // More files than the hashing queue takes at once
+        myDir.mkpath(tree + "/many");
+        for(int i = 0; i < 1000; ++i)
+            writeFile(treePath + "/many/f" + std::to_string(i) + ".txt", "1");
+        for(unsigned threads : {1u, 4u})
+        {
+            ok &= treeDir.fingerprintFiles(prints, std::vector<DirMan::FileFingerprint>(), {}, threads);
+            ok &= prints.size() == 1003;
+        }
+
+        if(ok)
+            std::cout << "fingerprint Ok!" << std::endl;
+        else
+            std::cout << "fingerprint FAILED!" << std::endl;
+
+        myDir.rmpath(tree);
+    }
+
+    std::cout << "=============Running test 10 (tree snapshots diff)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a/aa");
+        myDir.mkpath(tree + "/b");
+        writeFile(treePath + "/f0.txt", "0");
+        writeFile(treePath + "/a/f1.txt", "1");
+        writeFile(treePath + "/a/aa/f2.txt", "2");
+        writeFile(treePath + "/b/f3.txt", "3");
+
+        DirMan treeDir(treePath);
+        DirMan::TreeSnapshot snapA, snapB;
+        std::vector<DirMan::TreeChange> changes;
+
+        bool ok = treeDir.takeSnapshot(snapA);
+        ok &= treeDir.takeSnapshot(snapB);
+        DirMan::diffSnapshots(snapA, snapB, changes);
+        ok &= changes.empty();
+
+        writeFile(treePath + "/a/aa/f2.txt", "changed");
+        writeFile(treePath + "/b/f4.txt", "4");
+        std::remove((treePath + "/f0.txt").c_str());
+
+        ok &= treeDir.takeSnapshot(snapB);
+        DirMan::diffSnapshots(snapA, snapB, changes);
+        for(const DirMan::TreeChange &c : changes)
+            std::cout << c.type << " " << c.path << std::endl;
+
+        ok &= changes.size() == 3;
+        ok &= changes[0].type == DirMan::TreeChange::REMOVED && changes[0].path == "f0.txt";
+        ok &= changes[1].type == DirMan::TreeChange::MODIFIED && changes[1].path == "a/aa/f2.txt";
+        ok &= changes[2].type == DirMan::TreeChange::ADDED && changes[2].path == "b/f4.txt";
+
+        if(ok)
+            std::cout << "snapshot Ok!" << std::endl;
+        else
+            std::cout << "snapshot FAILED!" << std::endl;
+
+        myDir.rmpath(tree);
+    }
+
+    std::cout << "=============Running test 11 (in-memory backend)=============" << std::endl;
+    {
+        std::shared_ptr<DirManMemoryBackend> mem(new DirManMemoryBackend);
+        mem->addFile("/mem/root/f0.txt", "0");
+        mem->addFile("/mem/root/a/f1.txt", "1");
+        mem->addFile("/mem/root/a/aa/f2.txt", "2");
+        mem->addFile("/mem/root/.git/f3.txt", "3");
+        mem->setLatency(DirManMemoryBackend::OP_OPEN_DIR, 1000);
+
+        DirMan::setBackend(mem);
+
+        DirMan memDir("/mem/root");
+        DirMan::WalkerOptions opts;
+        opts.pruneNames.push_back(".git");
+
+        size_t found = 0;
+        memDir.beginWalking(opts);
+        while(memDir.fetchListFromWalker(itPath, files))
+            found += files.size();
+
+        bool ok = found == 3 && mem->operationsCount(DirManMemoryBackend::OP_OPEN_DIR) == 3;
+        ok &= mem->simulatedTime() == 3000;
+        ok &= memDir.mkpath("b/bb/bbb") && memDir.existsRel("b/bb/bbb");
+        ok &= memDir.rmpath("a") && !memDir.existsRel("a");
+
+        // Backend paths are cleaned, relative ones start at the root of the backend
+        DirMan relDir("mem/root/b/../c/");
+        ok &= relDir.absolutePath() == "/mem/root/c";
+        ok &= relDir.mkpath("cc/../dd") && DirMan::exists("/mem/root/c/dd") && !DirMan::exists("/mem/root/c/cc");
+        ok &= DirMan::mkAbsPath("mem/x/../y") && DirMan::exists("/mem/y") && !DirMan::exists("/mem/x");
+
+        DirMan::setBackend(std::shared_ptr<DirManBackend>());
+
+        if(ok)
+            std::cout << "memory backend Ok!" << std::endl;
+        else
+            std::cout << "memory backend FAILED!" << std::endl;
+    }
+
+#ifndef _WIN32
+    std::cout << "=============Running test 12 (walk through symbolic links)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a");
+        myDir.mkpath(tree + "/b");
+        writeFile(treePath + "/a/f1.txt", "1");
+        writeFile(treePath + "/b/f2.txt", "2");
+        bool ok = symlink("..", (treePath + "/a/loop").c_str()) == 0;
+        ok &= symlink("../a", (treePath + "/b/link").c_str()) == 0;
+
+        DirMan treeDir(treePath);
+        DirMan::WalkerOptions opts;
+        size_t found = 0, dirs = 0;
+
+        opts.followSymlinks = false;
+        treeDir.beginWalking(opts);
+        while(treeDir.fetchListFromWalker(itPath, files))
+        {
+            found += files.size();
+            dirs++;
+        }
+        ok &= found == 2 && dirs == 3;
+
+        // Links are followed by default
+        opts = DirMan::WalkerOptions();
+        found = 0;
+        dirs = 0;
+        treeDir.beginWalking(opts);
+        while(treeDir.fetchListFromWalker(itPath, files) && dirs < 100)
+        {
+            found += files.size();
+            dirs++;
+        }
+        ok &= found == 3 && dirs == 4; // "b/link" returns "a" again, loops back to the root are skipped
+
+        if(ok)
+            std::cout << "symlinks Ok!" << std::endl;
+        else
+            std::cout << "symlinks FAILED!" << std::endl;
+
+        // rmpath() follows links: remove them first
+        unlink((treePath + "/a/loop").c_str());
+        unlink((treePath + "/b/link").c_str());
+        myDir.rmpath(tree);
+    }
+#endif
+
+    std::cout << "=============Running test 13 (one file system walk)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a/b");
+        writeFile(treePath + "/a/b/f1.txt", "1");
+
+        DirMan treeDir(treePath);
+        DirMan::WalkerOptions opts;
+        opts.oneFileSystem = true;
+        size_t found = 0, dirs = 0;
+
+        treeDir.beginWalking(opts);
+        while(treeDir.fetchListFromWalker(itPath, files))
+        {
+            found += files.size();
+            dirs++;
+        }
+
+        std::string fsType = DirMan::fileSystemType(treePath);
+        std::cout << "File system: " << fsType << std::endl;
+        bool ok = found == 1 && dirs == 3;
+
+#ifdef __linux__
+        // Virtual file systems are skipped at their mount points
+        if(DirMan::fileSystemType("/proc") == "proc" && DirMan::fileSystemType("/") != "proc")
+        {
+            DirMan rootDir("/");
+            opts = DirMan::WalkerOptions();
+            opts.maxDepth = 1;
+            opts.skipFileSystems.push_back("proc");
+            rootDir.beginWalking(opts);
+            while(rootDir.fetchListFromWalker(itPath, files))
+                ok &= itPath != "//proc" && itPath != "/proc";
+        }
+#endif
+
+        if(ok)
+            std::cout << "one file system Ok!" << std::endl;
+        else
+            std::cout << "one file system FAILED!" << std::endl;
+
+        myDir.rmpath(tree);
+    }
+
+    std::cout << "=============Running test 14 (path resolution)=============" << std::endl;
+    {
+        bool ok = DirMan::cleanPath("/a//b/./c/../d/") == "/a/b/d";
+        ok &= DirMan::cleanPath("/../a/..") == "/";
+        ok &= DirMan::cleanPath("../../a/../b/.") == "../../b";
+        ok &= DirMan::cleanPath("a/..") == ".";
+
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a/b");
+#ifndef _WIN32
+        ok &= symlink("a/b", (treePath + "/l").c_str()) == 0;
+        const std::string linked = treePath + "/./l/..//b";
+
+        DirMan::setPathResolution(DirMan::PATH_RESOLVE_STRICT);
+        DirMan strict(linked);
+        DirMan::setPathResolution(DirMan::PATH_RESOLVE_CACHED);
+        DirMan cached(linked);
+        DirMan cachedAgain(linked);
+        DirMan::setPathResolution(DirMan::PATH_RESOLVE_LEXICAL);
+        DirMan lexical(linked);
+        DirMan::setPathResolution(DirMan::PATH_RESOLVE_CACHED);
+
+        std::cout << strict.absolutePath() << std::endl;
+        ok &= strict.absolutePath() == treePath + "/a/b";
+        ok &= cached.absolutePath() == strict.absolutePath();
+        ok &= cachedAgain.absolutePath() == strict.absolutePath();
+        ok &= lexical.absolutePath() == treePath + "/b";
+        ok &= DirMan(cached).absolutePath() == cached.absolutePath();
+        ok &= DirMan(treePath + "/a/missing/../x").absolutePath() == treePath + "/a/x";
+        unlink((treePath + "/l").c_str());
+#endif
+
+        if(ok)
+            std::cout << "path resolution Ok!" << std::endl;
+        else
+            std::cout << "path resolution FAILED!" << std::endl;
+
+        myDir.rmpath(tree);
+    }
+
+    std::cout << "=============Running test 16 (case-insensitive paths)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/Graphics/Level");
+        writeFile(treePath + "/Graphics/Level/block-1.png", "1");
+
+        DirMan treeDir(treePath);
+        std::string resolved;
+        bool ok = treeDir.resolveCaseInsensitive("graphics\\LEVEL/Block-1.PNG", resolved);
+        std::cout << resolved << std::endl;
+        ok &= resolved == "Graphics/Level/block-1.png";
+        ok &= !treeDir.resolveCaseInsensitive("graphics/level/block-2.png", resolved);
+
+        // The cache of the directory gets refreshed when it changes
+        writeFile(treePath + "/Graphics/Level/Block-2.png", "2");
+        ok &= treeDir.resolveCaseInsensitive("GRAPHICS/level/BLOCK-2.PNG", resolved);
+        ok &= resolved == "Graphics/Level/Block-2.png";
+
+        myDir.rmpath(tree);
+
+        // Directories are read once while they don't change
+        std::shared_ptr<DirManMemoryBackend> mem(new DirManMemoryBackend);
+        mem->addFile("/mem/Graphics/Level/block-1.png", "1");
+        mem->addFile("/mem/Graphics/Level/block-2.png", "2");
+        DirMan::setBackend(mem);
+
+        DirMan memDir("/mem");
+        ok &= memDir.resolveCaseInsensitive("graphics/level/BLOCK-1.png", resolved);
+        uint64_t reads = mem->operationsCount(DirManMemoryBackend::OP_OPEN_DIR);
+        ok &= memDir.resolveCaseInsensitive("graphics/level/BLOCK-2.png", resolved);
+        ok &= resolved == "Graphics/Level/block-2.png";
+        ok &= reads == 3 && mem->operationsCount(DirManMemoryBackend::OP_OPEN_DIR) == reads;
+
+        // Paths are cleaned first: "a/../b" shares the cache entries of "b"
+        ok &= memDir.resolveCaseInsensitive("Sound/../GRAPHICS/./Level/BLOCK-1.png", resolved);
+        ok &= resolved == "Graphics/Level/block-1.png";
+        ok &= mem->operationsCount(DirManMemoryBackend::OP_OPEN_DIR) == reads;
+
+        // A backend may call DirMan while a directory gets read: no lock is held over the I/O
+        struct ReentrantBackend : public DirManMemoryBackend
+        {
+            bool inner = false;
+            bool innerOk = false;
+
+            DirHandle openDir(const std::string &path) override
+            {
+                if(!inner)
+                {
+                    inner = true;
+                    std::string r;
+                    innerOk = DirMan("/mem").resolveCaseInsensitive("SOUND/HIT.ogg", r) && r == "Sound/hit.ogg";
+                }
+                return DirManMemoryBackend::openDir(path);
+            }
+        };
+
+        std::shared_ptr<ReentrantBackend> reentrant(new ReentrantBackend);
+        reentrant->addFile("/mem/Graphics/block-1.png", "1");
+        reentrant->addFile("/mem/Sound/hit.ogg", "2");
+        DirMan::setBackend(reentrant);
+        ok &= DirMan("/mem").resolveCaseInsensitive("graphics/BLOCK-1.png", resolved) && reentrant->innerOk;
+
+        DirMan::setBackend(std::shared_ptr<DirManBackend>());
+
+        if(ok)
+            std::cout << "case-insensitive paths Ok!" << std::endl;
+        else
+            std::cout << "case-insensitive paths FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 17 (walker checkpoint)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a/aa");
+        myDir.mkpath(tree + "/b/bb");
+        myDir.mkpath(tree + "/c");
+        writeFile(treePath + "/f0.txt", "0");
+        writeFile(treePath + "/.ignore", "*.bak\n");
+        writeFile(treePath + "/a/aa/f1.txt", "1");
+        writeFile(treePath + "/a/aa/f1.bak", "1");
+        writeFile(treePath + "/b/bb/f2.txt", "2");
+        writeFile(treePath + "/b/bb/f2.bak", "2");
+        writeFile(treePath + "/c/f3.txt", "3");
+
+        DirMan::WalkerOptions opts;
+        opts.ignoreFileName = ".ignore";
+        std::vector<std::string> all, resumed;
+
+        DirMan treeDir(treePath);
+        treeDir.beginWalking(opts);
+        while(treeDir.fetchListFromWalker(itPath, files))
+        {
+            for(std::string &f : files)
+                all.push_back(itPath + "/" + f);
+        }
+
+        // Interrupt the walk after two directories
+        std::string checkpoint;
+        treeDir.beginWalking(opts);
+        for(int i = 0; i < 2 && treeDir.fetchListFromWalker(itPath, files); ++i)
+        {
+            for(std::string &f : files)
+                resumed.push_back(itPath + "/" + f);
+        }
+        bool ok = treeDir.saveWalkerCheckpoint(checkpoint);
+        std::cout << "Checkpoint size: " << checkpoint.size() << std::endl;
+
+        DirMan other;
+        ok &= other.resumeWalking(checkpoint);
+        ok &= other.absolutePath() == treeDir.absolutePath();
+        while(other.fetchListFromWalker(itPath, files))
+        {
+            for(std::string &f : files)
+                resumed.push_back(itPath + "/" + f);
+        }
+
+        std::sort(all.begin(), all.end());
+        std::sort(resumed.begin(), resumed.end());
+        ok &= all.size() == 5 && all == resumed; // Includes the rules file
+
+        // Damaged checkpoints are refused
+        checkpoint[checkpoint.size() / 2] ^= 0x20;
+        ok &= !other.resumeWalking(checkpoint);
+        ok &= !other.fetchListFromWalker(itPath, files);
+
+        // Directories entered without links are not saved: the size follows the pending ones only
+        for(int i = 0; i < 200; ++i)
+            myDir.mkpath(tree + "/wide/d" + std::to_string(i));
+        DirMan wideDir(treePath + "/wide");
+        size_t lastSize = 0;
+        wideDir.beginWalking(DirMan::WalkerOptions());
+        while(wideDir.fetchListFromWalker(itPath, files))
+        {
+            ok &= wideDir.saveWalkerCheckpoint(checkpoint);
+            ok &= lastSize == 0 || checkpoint.size() <= lastSize;
+            lastSize = checkpoint.size();
+        }
+        std::cout << "Final checkpoint size: " << lastSize << std::endl;
+        ok &= lastSize < 256;
+
+        if(ok)
+            std::cout << "walker checkpoint Ok!" << std::endl;
+        else
+            std::cout << "walker checkpoint FAILED!" << std::endl;
+
+        myDir.rmpath(tree);
+    }
+
+    std::cout << "=============Running test 18 (read-ahead walker)=============" << std::endl;
+    {
+        std::shared_ptr<DirManMemoryBackend> mem(new DirManMemoryBackend);
+        for(int i = 0; i < 20; ++i)
+            mem->addFile("/mem/d" + std::to_string(i) + "/f.txt", "1");
+        mem->setLatency(DirManMemoryBackend::OP_OPEN_DIR, 2000);
+        mem->setRealDelays(true);
+        DirMan::setBackend(mem);
+
+        DirMan memDir("/mem");
+        DirMan::WalkerOptions opts;
+        std::vector<std::string> plain, ahead;
+        double plainMs = 0.0, aheadMs = 0.0;
+
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            opts.prefetchDirectories = pass ? 4 : 0;
+            std::vector<std::string> &out = pass ? ahead : plain;
+            auto start = std::chrono::steady_clock::now();
+            memDir.beginWalking(opts);
+            while(memDir.fetchListFromWalker(itPath, files))
+            {
+                // Simulate processing of the files
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                for(std::string &f : files)
+                    out.push_back(itPath + "/" + f);
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            (pass ? aheadMs : plainMs) = ms;
+        }
+
+        std::cout << "Without read-ahead: " << plainMs << " ms, with read-ahead: " << aheadMs << " ms" << std::endl;
+
+        // Stop in the middle: the reading thread gets joined
+        memDir.beginWalking(opts);
+        bool ok = memDir.fetchListFromWalker(itPath, files);
+        memDir.beginWalking(opts);
+        size_t count = 0;
+        while(memDir.fetchListFromWalker(itPath, files))
+            count++;
+
+        // Directories read ahead are saved with the checkpoint
+        std::string checkpoint;
+        memDir.beginWalking(opts);
+        ok &= memDir.fetchListFromWalker(itPath, files);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ok &= memDir.saveWalkerCheckpoint(checkpoint);
+        DirMan resumed;
+        ok &= resumed.resumeWalking(checkpoint);
+        size_t resumedCount = 1;
+        while(resumed.fetchListFromWalker(itPath, files))
+            resumedCount++;
+
+        DirMan::setBackend(std::shared_ptr<DirManBackend>());
+
+        ok &= plain.size() == 20 && plain == ahead && count == 21 && resumedCount == 21;
+        if(ok)
+            std::cout << "read-ahead walker Ok!" << std::endl;
+        else
+            std::cout << "read-ahead walker FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 19 (batched walker)=============" << std::endl;
+    {
+        std::shared_ptr<DirManMemoryBackend> mem(new DirManMemoryBackend);
+        for(int i = 0; i < 20; ++i)
+            mem->addFile("/mem/d" + std::to_string(i) + "/f.txt", "1");
+        DirMan::setBackend(mem);
+
+        DirMan memDir("/mem");
+        DirMan::WalkerOptions opts;
+        std::vector<std::string> plain, batched;
+        std::vector<DirMan::WalkerResult> results;
+        bool ok = true;
+
+        memDir.beginWalking(opts);
+        while(memDir.fetchListFromWalker(itPath, files))
+        {
+            for(std::string &f : files)
+                plain.push_back(itPath + "/" + f);
+        }
+
+        for(int pass = 0; pass < 2; ++pass)
+        {
+            // Each directory with one file takes two entries
+            opts.prefetchDirectories = pass ? 4 : 0;
+            memDir.beginWalking(opts);
+            size_t got, batches = 0, dirs = 0;
+            batched.clear();
+            while((got = memDir.fetchBatchFromWalker(results, 8)) > 0)
+            {
+                ok &= got <= 5;
+                batches++;
+                dirs += got;
+                for(size_t i = 0; i < got; ++i)
+                {
+                    for(std::string &f : results[i].files)
+                        batched.push_back(results[i].path + "/" + f);
+                }
+            }
+            ok &= dirs == 21 && batched == plain && (pass || batches == 5);
+        }
+
+        // The byte limit: a directory is never split
+        opts.prefetchDirectories = 0;
+        memDir.beginWalking(opts);
+        ok &= memDir.fetchBatchFromWalker(results, 0, 1) == 1;
+        ok &= memDir.fetchBatchFromWalker(results, 0) == 20;
+        ok &= memDir.fetchBatchFromWalker(results, 0) == 0;
+
+        DirMan::setBackend(std::shared_ptr<DirManBackend>());
+
+        ok &= plain.size() == 20;
+        if(ok)
+            std::cout << "batched walker Ok!" << std::endl;
+        else
+            std::cout << "batched walker FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 20 (split walker)=============" << std::endl;
+    {
+        std::shared_ptr<DirManMemoryBackend> mem(new DirManMemoryBackend);
+        for(int i = 0; i < 4; ++i)
+        {
+            for(int j = 0; j < 4; ++j)
+                mem->addFile("/mem/a" + std::to_string(i) + "/b" + std::to_string(j) + "/f.txt", "1");
+        }
+        DirMan::setBackend(mem);
+
+        DirMan memDir("/mem");
+        DirMan::WalkerOptions opts;
+        std::vector<std::string> plain, parallel;
+
+        memDir.beginWalking(opts);
+        while(memDir.fetchListFromWalker(itPath, files))
+        {
+            for(std::string &f : files)
+                plain.push_back(itPath + "/" + f);
+        }
+
+        // Read the root, then share the rest between four walkers
+        std::vector<DirMan> walkers(4, memDir);
+        bool ok = walkers[0].beginWalking(opts) && walkers[0].fetchListFromWalker(itPath, files);
+        ok &= !walkers[0].splitWalker(walkers[0]);
+        ok &= walkers[0].splitWalker(walkers[1]);
+        ok &= walkers[0].splitWalker(walkers[2]);
+        ok &= walkers[1].splitWalker(walkers[3]);
+        ok &= !walkers[3].splitWalker(walkers[2]); // Only one pending directory left
+
+        std::vector<std::vector<std::string> > found(walkers.size());
+        std::vector<std::thread> threads;
+        for(size_t i = 0; i < walkers.size(); ++i)
+        {
+            threads.emplace_back([&walkers, &found, i]()
+            {
+                std::string path;
+                std::vector<std::string> list;
+                while(walkers[i].fetchListFromWalker(path, list))
+                {
+                    for(std::string &f : list)
+                        found[i].push_back(path + "/" + f);
+                }
+            });
+        }
+
+        for(std::thread &t : threads)
+            t.join();
+
+        for(std::vector<std::string> &f : found)
+        {
+            ok &= !f.empty();
+            parallel.insert(parallel.end(), f.begin(), f.end());
+        }
+
+        // The budget is shared too
+        opts.maxDirectories = 9;
+        walkers[0].beginWalking(opts);
+        walkers[0].fetchListFromWalker(itPath, files);
+        ok &= walkers[0].splitWalker(walkers[1]);
+        size_t dirs = 1;
+        for(size_t i = 0; i < 2; ++i)
+        {
+            while(walkers[i].fetchListFromWalker(itPath, files))
+                dirs++;
+        }
+
+        DirMan::setBackend(std::shared_ptr<DirManBackend>());
+
+#ifndef _WIN32
+        // A directory linked from both halves is entered by one of them only
+        {
+            const std::string tree = "Walker tree which must not exist!!!";
+            const std::string treePath = myDir.absolutePath() + "/" + tree;
+            myDir.mkpath(tree + "/w/a");
+            myDir.mkpath(tree + "/w/b");
+            myDir.mkpath(tree + "/target");
+            writeFile(treePath + "/target/f.txt", "1");
+            ok &= symlink("../../target", (treePath + "/w/a/link").c_str()) == 0;
+            ok &= symlink("../../target", (treePath + "/w/b/link").c_str()) == 0;
+
+            DirMan halves[2] = {DirMan(treePath + "/w"), DirMan(treePath + "/w")};
+            ok &= halves[0].beginWalking(DirMan::WalkerOptions()) && halves[0].fetchListFromWalker(itPath, files);
+            ok &= halves[0].splitWalker(halves[1]);
+            // Nothing to share: the walk of the other one is kept
+            ok &= !halves[1].splitWalker(halves[0]);
+
+            size_t linked = 0, linkDirs = 0;
+            for(DirMan &h : halves)
+            {
+                while(h.fetchListFromWalker(itPath, files))
+                {
+                    linked += files.size();
+                    linkDirs++;
+                }
+            }
+            ok &= linked == 1 && linkDirs == 3;
+
+            unlink((treePath + "/w/a/link").c_str());
+            unlink((treePath + "/w/b/link").c_str());
+            myDir.rmpath(tree);
+        }
+#endif
+
+        std::sort(plain.begin(), plain.end());
+        std::sort(parallel.begin(), parallel.end());
+        ok &= plain.size() == 16 && plain == parallel && dirs == 9;
+        if(ok)
+            std::cout << "split walker Ok!" << std::endl;
+        else
+            std::cout << "split walker FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 21 (asynchronous calls)=============" << std::endl;
+    {
+        const std::string tree = "Async tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        bool ok = true;
+
+        DirManAsync::Task mk = DirManAsync::mkAbsPath(treePath + "/a/b");
+        mk.wait();
+        ok &= mk.succeeded() && myDir.existsRel(tree + "/a/b");
+        for(int i = 0; i < 10; ++i)
+            writeFile(treePath + "/a/f" + std::to_string(i) + ".txt", "1");
+
+        std::vector<std::string> listed, walked;
+        DirManAsync::Task list = DirManAsync::getListOfFiles(treePath + "/a", {".txt"},
+                                 [&listed](bool res, std::vector<std::string> &l)
+        {
+            if(res)
+                listed.swap(l);
+        });
+
+        std::atomic<size_t> dirsRead(0);
+        DirManAsync::Task walk = DirManAsync::walk(treePath, DirMan::WalkerOptions(), {},
+                                 [&walked](bool res, std::vector<std::string> &l)
+        {
+            if(res)
+                walked.swap(l);
+        },
+        [&dirsRead](size_t n)
+        {
+            dirsRead = n;
+        });
+
+        list.wait();
+        walk.wait();
+        ok &= list.succeeded() && listed.size() == 10;
+        ok &= walk.succeeded() && walked.size() == 10 && dirsRead == 3 && walk.progress() == 3;
+
+#ifndef PGE_NO_THREADING
+        // Queued jobs don't start once cancelled
+        DirManAsync::setMaxThreads(1);
+        std::atomic<bool> release(false);
+        DirManAsync::Task blocker = DirManAsync::mkAbsPath(treePath, [&release](bool)
+        {
+            while(!release)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        });
+        bool cancelledResult = true;
+        DirManAsync::Task queued = DirManAsync::rmAbsPath(treePath, [&cancelledResult](bool res)
+        {
+            cancelledResult = res;
+        });
+        queued.cancel();
+        release = true;
+        queued.wait();
+        ok &= blocker.isFinished() && queued.isCancelled() && !queued.succeeded() && !cancelledResult;
+        ok &= myDir.existsRel(tree + "/a/b") && queued.progress() == 0;
+
+        // Running removal stops at the next entry
+        std::atomic<bool> stopAt(false);
+        DirManAsync::Task rm = DirManAsync::rmAbsPath(treePath, nullptr, [&stopAt](size_t n)
+        {
+            if(n == 3)
+            {
+                stopAt = true;
+                while(stopAt)
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        while(!stopAt)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        rm.cancel();
+        stopAt = false;
+        rm.wait();
+        ok &= !rm.succeeded() && rm.progress() == 3 && myDir.existsRel(tree + "/a");
+        DirManAsync::setMaxThreads(0);
+#endif
+
+        DirManAsync::Task rmAll = DirManAsync::rmAbsPath(treePath);
+        rmAll.wait();
+        ok &= rmAll.succeeded() && !myDir.existsRel(tree);
+        DirManAsync::shutdown();
+
+        if(ok)
+            std::cout << "asynchronous calls Ok!" << std::endl;
+        else
+            std::cout << "asynchronous calls FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 22 (compact pending directories)=============" << std::endl;
+    {
+        std::shared_ptr<DirManMemoryBackend> mem(new DirManMemoryBackend);
+        for(int i = 0; i < 5; ++i)
+        {
+            for(int j = 0; j < 5; ++j)
+            {
+                for(int k = 0; k < 3; ++k)
+                    mem->addFile("/mem/a" + std::to_string(i) + "/b" + std::to_string(j) + "/c" + std::to_string(k) + "/f.txt", "1");
+            }
+        }
+        DirMan::setBackend(mem);
+
+        DirMan memDir("/mem");
+        DirMan::WalkerOptions opts;
+        opts.order = DirMan::WalkerOptions::BREADTH_FIRST;
+        std::vector<std::string> all, resumed;
+
+        memDir.beginWalking(opts);
+        while(memDir.fetchListFromWalker(itPath, files))
+        {
+            for(std::string &f : files)
+                all.push_back(itPath + "/" + f);
+        }
+
+        // Stop in the middle of the second level: pending paths share parents of different depths
+        std::string checkpoint;
+        memDir.beginWalking(opts);
+        for(int i = 0; i < 10 && memDir.fetchListFromWalker(itPath, files); ++i)
+        {
+            for(std::string &f : files)
+                resumed.push_back(itPath + "/" + f);
+        }
+        bool ok = memDir.saveWalkerCheckpoint(checkpoint);
+
+        DirMan first, second;
+        ok &= first.resumeWalking(checkpoint) && first.splitWalker(second);
+        for(DirMan *w : {&first, &second})
+        {
+            while(w->fetchListFromWalker(itPath, files))
+            {
+                for(std::string &f : files)
+                    resumed.push_back(itPath + "/" + f);
+            }
+        }
+
+        // The interrupted walker is still able to finish
+        size_t rest = 0;
+        while(memDir.fetchListFromWalker(itPath, files))
+            rest += files.size();
+
+        DirMan::setBackend(std::shared_ptr<DirManBackend>());
+
+        std::sort(all.begin(), all.end());
+        std::sort(resumed.begin(), resumed.end());
+        ok &= all.size() == 75 && all == resumed && rest == 75;
+        if(ok)
+            std::cout << "compact pending directories Ok!" << std::endl;
+        else
+            std::cout << "compact pending directories FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 23 (compile-time suffix filters)=============" << std::endl;
+    {
+        constexpr auto images = DirMan::suffixes(".png", ".GIF", ".tar.backup");
+        static_assert(images.packed[0] == 0x2E706E67ULL && images.length[2] == 11, "Suffixes are packed at compile time");
+
+        const std::vector<std::string> imagesList = {".png", ".gif", ".tar.backup"};
+        const char *names[] = {"a.png", "A.PNG", "b.Gif", "png", ".png", "x.pngx", "", "c.jpeg",
+                               "d.TAR.Backup", "d.zar.backup", "tar.backup", "e.tar.backup.png", "\xC0.png"};
+        bool ok = true;
+        for(const char *n : names)
+            ok &= DirMan::matchSuffixFilters(n, images) == DirMan::matchSuffixFilters(n, imagesList);
+        ok &= DirMan::matchSuffixFilters("A.PNG", images) && !DirMan::matchSuffixFilters("d.zar.backup", images);
+
+        const std::string tree = "Suffix tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/sub.png");
+        writeFile(treePath + "/one.png", "1");
+        writeFile(treePath + "/two.GIF", "1");
+        writeFile(treePath + "/three.txt", "1");
+
+        DirMan treeDir(treePath);
+        std::vector<std::string> compiled, runtime;
+        ok &= treeDir.getListOfFiles(compiled, images) && treeDir.getListOfFiles(runtime, imagesList);
+        std::sort(compiled.begin(), compiled.end());
+        std::sort(runtime.begin(), runtime.end());
+        ok &= compiled.size() == 2 && compiled == runtime;
+        ok &= treeDir.getListOfFolders(compiled, DirMan::suffixes(".png")) && compiled.size() == 1;
+        myDir.rmpath(tree);
+
+        if(ok)
+            std::cout << "compile-time suffix filters Ok!" << std::endl;
+        else
+            std::cout << "compile-time suffix filters FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 24 (count queries)=============" << std::endl;
+    {
+        const std::string tree = "Count tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a/b.wld");
+        myDir.mkpath(tree + "/c");
+        writeFile(treePath + "/one.lvlx", "1");
+        writeFile(treePath + "/two.LVLX", "1");
+        writeFile(treePath + "/a/three.lvlx", "1");
+        writeFile(treePath + "/a/b.wld/four.lvlx", "1");
+        writeFile(treePath + "/a/b.wld/map.wld", "1");
+        writeFile(treePath + "/c/notes.txt", "1");
+#ifndef _WIN32
+        // Links to directories are not entered
+        bool linked = symlink(treePath.c_str(), (treePath + "/c/loop").c_str()) == 0;
+#else
+        bool linked = false;
+#endif
+
+        constexpr auto levels = DirMan::suffixes(".lvlx");
+        constexpr auto worlds = DirMan::suffixes(".wld");
+        DirMan treeDir(treePath);
+        bool ok = true;
+
+        size_t before = g_allocations;
+        ok &= treeDir.countFiles(levels) == 2;
+        ok &= treeDir.countFiles(levels, true) == 4;
+        ok &= treeDir.countFolders(worlds, true) == 1;
+        ok &= !treeDir.containsAny(worlds);
+        ok &= treeDir.containsAny(worlds, true);
+        size_t allocations = g_allocations - before;
+        std::cout << "Allocations: " << allocations << std::endl;
+        ok &= allocations == 0;
+
+        ok &= treeDir.countFiles() == 2 && treeDir.countFiles(std::vector<std::string>(), true) == 6;
+        ok &= treeDir.countFolders(std::vector<std::string>(), true) == (linked ? 4u : 3u);
+        ok &= treeDir.countFiles({".lvlx"}, true) == 4 && treeDir.containsAny({".txt"}, true);
+        ok &= !treeDir.containsAny({".lvl"}, true);
+        ok &= DirMan(treePath + "/nothing").countFiles() == 0;
+#ifndef _WIN32
+        unlink((treePath + "/c/loop").c_str());
+#endif
+        myDir.rmpath(tree);
+
+        if(ok)
+            std::cout << "count queries Ok!" << std::endl;
+        else
+            std::cout << "count queries FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 25 (classification walk)=============" << std::endl;
+    {
+        const std::string tree = "Classify tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/graphics");
+        myDir.mkpath(tree + "/music/old");
+        writeFile(treePath + "/level.lvlx", "1");
+        writeFile(treePath + "/graphics/a.png", "1");
+        writeFile(treePath + "/graphics/b.GIF", "1");
+        writeFile(treePath + "/music/old/song.ogg", "1");
+        writeFile(treePath + "/music/cover.png", "1");
+        writeFile(treePath + "/readme.txt", "1");
+
+        std::vector<DirMan::FileGroup> groups(3);
+        groups[0].name = "graphics";
+        groups[0].suffixFilters = {".png", ".GIF"};
+        groups[1].name = "music";
+        groups[1].suffixFilters = {".ogg"};
+        groups[2].name = "media";
+        groups[2].suffixFilters = {".png", ".ogg"};
+
+        std::vector<DirMan::FileBucket> buckets;
+        DirMan treeDir(treePath);
+        bool ok = treeDir.classifyFiles(buckets, groups);
+        ok &= buckets.size() == 4 && buckets[3].name == "unclassified";
+        if(ok)
+        {
+            ok &= buckets[0].count == 3 && buckets[0].files.size() == 3;
+            ok &= buckets[1].count == 1 && buckets[1].files[0] == treePath + "/music/old/song.ogg";
+            ok &= buckets[2].count == 3;
+            ok &= buckets[3].count == 2 && buckets[3].files.size() == 2;
+        }
+
+        ok &= treeDir.classifyFiles(buckets, groups, false) && buckets[0].count == 3 && buckets[0].files.empty();
+        ok &= !DirMan(treePath + "/nothing").classifyFiles(buckets, groups);
+        myDir.rmpath(tree);
+
+        if(ok)
+            std::cout << "classification walk Ok!" << std::endl;
+        else
+            std::cout << "classification walk FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 26 (sharded walk)=============" << std::endl;
+    {
+        const std::string tree = "Shard tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree);
+        writeFile(treePath + "/root.txt", "1");
+        for(int i = 0; i < 12; ++i)
+        {
+            const std::string sub = "/d" + std::to_string(i);
+            myDir.mkpath(tree + sub + "/x/y");
+            writeFile(treePath + sub + "/a.txt", "1");
+            writeFile(treePath + sub + "/x/b.txt", "1");
+            writeFile(treePath + sub + "/x/y/c.txt", "1");
+        }
+
+        const size_t shards = 3;
+        DirMan treeDir(treePath);
+        DirMan::WalkerOptions options;
+        options.shardCount = shards;
+
+        // Files and the count of read directories of one shard
+        auto walkShard = [&](size_t index, size_t depth, std::vector<std::string> &files) -> size_t
+        {
+            DirMan::WalkerOptions o = options;
+            o.shardIndex = index;
+            o.shardDepth = depth;
+            DirMan walker(treePath);
+            std::string curPath;
+            std::vector<std::string> list;
+            size_t dirs = 0;
+            files.clear();
+            walker.beginWalking(o);
+            while(walker.fetchListFromWalker(curPath, list))
+            {
+                dirs++;
+                for(const std::string &f : list)
+                    files.push_back(curPath + "/" + f);
+            }
+            return dirs;
+        };
+
+        std::vector<std::vector<std::string> > shardFiles(shards);
+        std::vector<std::string> missing, duplicated;
+        bool ok = true;
+
+        // Every shard reads its own sub-trees only
+        size_t readDirs = 0;
+        for(size_t i = 0; i < shards; ++i)
+        {
+            size_t dirs = walkShard(i, 2, shardFiles[i]);
+            ok &= dirs < 1 + 12 * 3;
+            readDirs += dirs;
+        }
+        // Levels above the shard depth are read by every shard
+        ok &= readDirs == shards * (1 + 12) + 12 * 2;
+        ok &= treeDir.verifyShardCoverage(options, shardFiles, missing, duplicated);
+
+        // Overlapping and incomplete shards are detected
+        shardFiles[1] = shardFiles[0];
+        ok &= !treeDir.verifyShardCoverage(options, shardFiles, missing, duplicated);
+        ok &= !duplicated.empty() && !missing.empty();
+
+#ifndef _WIN32
+        // Shards walked by separate processes
+        std::vector<pid_t> children;
+        for(size_t i = 0; i < shards; ++i)
+        {
+            pid_t pid = fork();
+            if(pid == 0)
+            {
+                std::vector<std::string> files;
+                walkShard(i, 1, files);
+                FILE *f = fopen((treePath + "/../shard" + std::to_string(i) + ".lst").c_str(), "w");
+                for(const std::string &file : files)
+                    fprintf(f, "%s\n", file.c_str());
+                fclose(f);
+                _exit(0);
+            }
+            children.push_back(pid);
+        }
+
+        for(pid_t pid : children)
+        {
+            int status = 0;
+            ok &= waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+
+        for(size_t i = 0; i < shards; ++i)
+        {
+            const std::string listPath = treePath + "/../shard" + std::to_string(i) + ".lst";
+            char line[4096];
+            shardFiles[i].clear();
+            FILE *f = fopen(listPath.c_str(), "r");
+            while(f && fgets(line, sizeof(line), f))
+            {
+                std::string file = line;
+                if(!file.empty() && file.back() == '\n')
+                    file.pop_back();
+                shardFiles[i].push_back(file);
+            }
+            if(f)
+                fclose(f);
+            ok &= f && !shardFiles[i].empty();
+            remove(listPath.c_str());
+        }
+
+        ok &= treeDir.verifyShardCoverage(options, shardFiles, missing, duplicated);
+#endif
+        myDir.rmpath(tree);
+
+        if(ok)
+            std::cout << "sharded walk Ok!" << std::endl;
+        else
+            std::cout << "sharded walk FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 27 (incremental rescan)=============" << std::endl;
+    {
+        const std::string tree = "Rescan tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/a/aa");
+        myDir.mkpath(tree + "/b");
+        myDir.mkpath(tree + "/c");
+        writeFile(treePath + "/a/aa/f2.txt", "2");
+        writeFile(treePath + "/b/f3.txt", "3");
+
+        // Directories changed right before a snapshot are read again by the next rescan
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        DirMan treeDir(treePath);
+        DirMan::TreeSnapshot snapA, snapB, snapC;
+        std::vector<DirMan::TreeChange> changes;
+        size_t readDirs = 0;
+
+        bool ok = treeDir.takeSnapshot(snapA);
+        ok &= treeDir.rescanSnapshot(snapA, snapB, changes, false, &readDirs);
+        ok &= readDirs == 0 && changes.empty() && snapB.root.digest == snapA.root.digest;
+
+        writeFile(treePath + "/b/new.txt", "new");
+        writeFile(treePath + "/a/aa/f2.txt", "changed");
+        myDir.mkpath(tree + "/c/d");
+
+        // Content changes keep the directory times
+        ok &= treeDir.rescanSnapshot(snapA, snapB, changes, false, &readDirs);
+        std::cout << "Read directories: " << readDirs << ", changes: " << changes.size() << std::endl;
+        ok &= readDirs == 3 && changes.size() == 2;
+        ok &= changes.size() == 2 && changes[0].type == DirMan::TreeChange::ADDED && changes[0].path == "b/new.txt";
+        ok &= changes.size() == 2 && changes[1].type == DirMan::TreeChange::ADDED && changes[1].path == "c/d";
+
+        ok &= treeDir.rescanSnapshot(snapA, snapC, changes, true, &readDirs);
+        ok &= readDirs == 3 && changes.size() == 3;
+        ok &= changes.size() == 3 && changes[0].type == DirMan::TreeChange::MODIFIED && changes[0].path == "a/aa/f2.txt";
+
+        // Fresh changes can't be trusted: those directories are read again
+        ok &= treeDir.rescanSnapshot(snapC, snapB, changes, true, &readDirs);
+        ok &= readDirs >= 3 && changes.empty();
+
+        ok &= !DirMan(treePath + "/nothing").rescanSnapshot(snapA, snapB, changes);
+        myDir.rmpath(tree);
+
+        if(ok)
+            std::cout << "incremental rescan Ok!" << std::endl;
+        else
+            std::cout << "incremental rescan FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 28 (paginated listing)=============" << std::endl;
+    {
+        const std::string tree = "Paged tree which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        myDir.mkpath(tree + "/sub1");
+        myDir.mkpath(tree + "/sub2");
+        myDir.mkpath(tree + "/sub3.bak");
+        for(int i = 0; i < 25; ++i)
+            writeFile(treePath + "/file" + std::to_string(i) + (i % 5 == 0 ? ".bak" : ".txt"), "1");
+
+        DirMan treeDir(treePath);
+        DirMan::ListCursor cursor;
+        std::vector<std::string> page, paged, all;
+        std::vector<size_t> sizes;
+        bool ok = true;
+
+        while(!cursor.done && ok)
+        {
+            ok &= treeDir.getPageOfFiles(cursor, page, 10);
+            sizes.push_back(page.size());
+            paged.insert(paged.end(), page.begin(), page.end());
+        }
+
+        ok &= treeDir.getListOfFiles(all);
+        std::sort(all.begin(), all.end());
+        std::sort(paged.begin(), paged.end());
+        ok &= all.size() == 25 && paged == all;
+        ok &= sizes.size() >= 3 && sizes[0] == 10 && sizes[1] == 10;
+
+        // The cursor is resumable by another object, filters apply to pages
+        DirMan::ListCursor first, second;
+        ok &= treeDir.getPageOfFiles(first, page, 2, DirMan::suffixes(".bak")) && page.size() == 2;
+        paged = page;
+        second = first;
+        while(!second.done && ok)
+        {
+            ok &= DirMan(treePath).getPageOfFiles(second, page, 2, {".bak"});
+            paged.insert(paged.end(), page.begin(), page.end());
+        }
+        ok &= paged.size() == 5;
+
+        DirMan::ListCursor folders;
+        ok &= treeDir.getPageOfFolders(folders, page, 100) && page.size() == 3 && folders.done;
+        ok &= treeDir.getPageOfFolders(folders, page, 100) && page.empty();
+
+        DirMan::ListCursor missing;
+        ok &= !DirMan(treePath + "/nothing").getPageOfFiles(missing, page, 10);
+        myDir.rmpath(tree);
+
+        if(ok)
+            std::cout << "paginated listing Ok!" << std::endl;
+        else
+            std::cout << "paginated listing FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 29 (giant directory listing)=============" << std::endl;
+    {
+        const std::string tree = "Giant dir which must not exist!!!";
+        const std::string treePath = myDir.absolutePath() + "/" + tree;
+        const int count = 6000;
+        myDir.mkpath(tree + "/sub");
+        for(int i = 0; i < count; ++i)
+            writeFile(treePath + "/entry_with_a_long_name_" + std::to_string(i) + ".dat", "");
+        // Names which look like "." and ".."
+        writeFile(treePath + "/.a", "");
+        writeFile(treePath + "/..b", "");
+        writeFile(treePath + "/...", "");
+
+        size_t expectedFiles = count + 3, expectedFolders = 1;
+#if !defined(_WIN32) && defined(DIRMAN_HAS_FSSTATAT)
+        // Links are listed by their targets
+        if(symlink("entry_with_a_long_name_0.dat", (treePath + "/file.lnk").c_str()) == 0)
+            expectedFiles++;
+        if(symlink("sub", (treePath + "/dir.lnk").c_str()) == 0)
+            expectedFolders++;
+#endif
+
+        DirMan treeDir(treePath);
+        std::vector<std::string> files, folders;
+        bool ok = treeDir.getListOfFiles(files) && treeDir.getListOfFolders(folders);
+        ok &= files.size() == expectedFiles && folders.size() == expectedFolders;
+        ok &= std::find(files.begin(), files.end(), "...") != files.end();
+        ok &= std::find(files.begin(), files.end(), "..b") != files.end();
+        ok &= std::find(folders.begin(), folders.end(), "sub") != folders.end();
+        ok &= treeDir.getListOfFiles(files, {".dat"}) && files.size() == count;
+
+        // A grown and then emptied directory keeps its size on most file systems
+        for(int i = 1; i < count; ++i)
+            ok &= std::remove((treePath + "/entry_with_a_long_name_" + std::to_string(i) + ".dat").c_str()) == 0;
+        std::vector<std::string> fresh;
+        ok &= treeDir.getListOfFiles(fresh, {".dat"}) && fresh.size() == 1;
+        std::vector<std::string> freshAll;
+        ok &= treeDir.getListOfFiles(freshAll) && freshAll.size() == expectedFiles - count + 1;
+        ok &= freshAll.capacity() < 4096;
+#if !defined(_WIN32) && defined(DIRMAN_HAS_FSSTATAT)
+        unlink((treePath + "/file.lnk").c_str());
+        unlink((treePath + "/dir.lnk").c_str());
+#endif
+        myDir.rmpath(tree);
+
+        if(ok)
+            std::cout << "giant directory listing Ok!" << std::endl;
+        else
+            std::cout << "giant directory listing FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 30 (bulk directory creation)=============" << std::endl;
+    {
+        const std::string tree = "Bulk mkpath tree which must not exist!!!";
+        const std::vector<std::string> paths =
+        {
+            "a/b/c", "a/b", "a-x/y", "./d//e/", "a/b/c", "z", "a/q/r/s"
+        };
+        const std::vector<std::string> expected =
+        {
+            "a", "a/b", "a/b/c", "a-x", "a-x/y", "d", "d/e", "z", "a/q/r/s"
+        };
+
+        bool ok = true;
+        for(unsigned threads : {1u, 4u})
+        {
+            DirMan packDir(myDir.absolutePath() + "/" + tree + "/pack");
+            ok &= packDir.mkpathMany(paths, threads);
+            for(const std::string &p : expected)
+                ok &= packDir.existsRel(p);
+            // Existing directories are fine
+            ok &= packDir.mkpathMany(paths, threads);
+            ok &= packDir.mkpathMany({});
+
+            // A file on the way fails only its own sub-tree
+            writeFile(packDir.absolutePath() + "/file", "");
+            ok &= !packDir.mkpathMany({"file/sub", "n/m"}, threads);
+            ok &= packDir.existsRel("n/m") && !packDir.existsRel("file/sub");
+
+            // Paths leaving the base directory are rejected before anything is made
+            ok &= !packDir.mkpathMany({"o/p", "q/../../escaped"}, threads);
+            ok &= !packDir.mkpathMany({"../escaped"}, threads);
+            ok &= !packDir.existsRel("o") && !myDir.existsRel(tree + "/escaped");
+            ok &= packDir.mkpathMany({"s/../t/./u/"}, threads) && packDir.existsRel("t/u") && !packDir.existsRel("s");
+            myDir.rmpath(tree);
+        }
+
+        if(ok)
+            std::cout << "bulk directory creation Ok!" << std::endl;
+        else
+            std::cout << "bulk directory creation FAILED!" << std::endl;
+    }
+
+#ifndef _WIN32
+    std::cout << "=============Running test 31 (removal of unreadable trees)=============" << std::endl;
+    {
+        // Directories deeper than PATH_MAX can't be opened by their full path, so they can't be removed
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string longName(200, 'x');
+        const int levels = 4096 / 200 + 2;
+        myDir.mkdir(tree);
+
+        std::vector<int> fds(1, open((myDir.absolutePath() + "/" + tree).c_str(), O_RDONLY | O_DIRECTORY));
+        for(int i = 0; i < levels && fds.back() >= 0; ++i)
+        {
+            mkdirat(fds.back(), longName.c_str(), 0755);
+            fds.push_back(openat(fds.back(), longName.c_str(), O_RDONLY | O_DIRECTORY));
+        }
+        bool ok = fds.back() >= 0;
+
+        // rmpath() must report the failure instead of finding that directory again forever
+        pid_t pid = fork();
+        if(pid == 0)
+        {
+            alarm(30);
+            _exit(myDir.rmpath(tree) ? 1 : 0);
+        }
+        int status = 0;
+        ok &= waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+        for(size_t i = fds.size() - 1; i > 0; --i)
+        {
+            close(fds[i]);
+            unlinkat(fds[i - 1], longName.c_str(), AT_REMOVEDIR);
+        }
+        close(fds[0]);
+        ok &= myDir.rmdir(tree);
+
+        if(ok)
+            std::cout << "unreadable tree removal Ok!" << std::endl;
+        else
+            std::cout << "unreadable tree removal FAILED!" << std::endl;
+    }
+#endif
+
+    std::cout << "=============Running test 32 (backend swaps)=============" << std::endl;
+    {
+        std::shared_ptr<DirManMemoryBackend> mem(new DirManMemoryBackend);
+        mem->addFile("/mem/root/f0.txt", "0123456789");
+        mem->addFile("/mem/root/a/f1.txt", "01234");
+        mem->addFile("/mem/root/a/aa/f2.txt", "same");
+        mem->addFile("/mem/root/b/f3.txt", "same");
+
+        // The native backend is installed by default
+        std::shared_ptr<DirManBackend> native = DirMan::backend();
+        bool ok = dynamic_cast<DirManNativeBackend*>(native.get()) != nullptr;
+
+        DirMan::setBackend(mem);
+        ok &= DirMan::backend() == mem;
+
+        DirMan memDir("/mem/root");
+        DirMan::DiskUsage du;
+        ok &= memDir.diskUsage(du, 2);
+        ok &= du.files == 4 && du.dirs == 3 && du.apparentBytes == 23;
+        ok &= du.children.size() == 2 && du.children[0].name == "a" && du.children[0].apparentBytes == 9;
+
+        std::vector<DirMan::FileFingerprint> prints, prints2;
+        std::vector<std::vector<size_t>> dups;
+        ok &= memDir.fingerprintFiles(prints);
+        DirMan::findDuplicates(prints, dups);
+        ok &= prints.size() == 4 && dups.size() == 1 && dups[0].size() == 2;
+
+        // Only the changed file is read again
+        mem->addFile("/mem/root/f0.txt", "9876543210");
+        ok &= memDir.fingerprintFiles(prints2, prints);
+        size_t reused = 0;
+        for(const DirMan::FileFingerprint &fp : prints2)
+            reused += fp.reused ? 1 : 0;
+        ok &= prints2.size() == 4 && reused == 3;
+
+        // The started walk keeps its backend alive and reads it after the native one is back
+        size_t found = 0;
+        memDir.beginWalking();
+        DirMan::setBackend(std::shared_ptr<DirManBackend>());
+        mem.reset();
+        ok &= DirMan::backend() == native && !DirMan::exists("/mem/root");
+        while(memDir.fetchListFromWalker(itPath, files))
+            found += files.size();
+        ok &= found == 4;
+
+        if(ok)
+            std::cout << "backend swaps Ok!" << std::endl;
+        else
+            std::cout << "backend swaps FAILED!" << std::endl;
+    }
+
+    std::cout << "=============Running test 15 (no allocations on paths)=============" << std::endl;
+    {
+        const std::string tree = "Walker tree which must not exist!!!";
+        const std::string deep = tree + "/a/b/c";
+        const std::string sub = tree + "/a/d";
+        myDir.mkpath(tree);
+        writeFile(myDir.absolutePath() + "/" + tree + "/f.txt", "1");
+
+        size_t before = g_allocations;
+        bool ok = myDir.existsRel(tree);
+        ok &= myDir.mkpath(deep);
+        ok &= myDir.mkdir(sub);
+        ok &= myDir.existsRel(sub);
+        ok &= myDir.rmdir(sub);
+        ok &= myDir.rmpath(tree);
+        ok &= !myDir.existsRel(tree);
+        size_t allocations = g_allocations - before;
+
+        std::cout << "Allocations: " << allocations << std::endl;
+        if(ok && allocations == 0)
+            std::cout << "no allocations Ok!" << std::endl;
+        else
+            std::cout << "no allocations FAILED!" << std::endl;
+    }
+
     return 0;
 }